@@ -1,5 +1,6 @@
 #include "include/arch/x86/acpi.h"
 #include "include/drivers/serial.h"
+#include "include/arch/x86/paging.h"
 #include <stdint.h>
 
 static const acpi_rsdp_t* g_rsdp = 0;
@@ -22,6 +23,16 @@ int acpi_table_checksum_ok(const void* table, uint32_t length){
     return checksum8((const uint8_t*)table, length) == 0;
 }
 
+// Tables usually sit at the top of RAM, outside the boot identity map:
+// map the header first, then the full length it reports.
+static const acpi_sdt_header_t* map_table(uint32_t phys){
+    if (!phys) return 0;
+    if (paging_map_identity(phys, sizeof(acpi_sdt_header_t), 0) < 0) return 0;
+    const acpi_sdt_header_t* h = (const acpi_sdt_header_t*)(uintptr_t)phys;
+    if (h->length < sizeof(acpi_sdt_header_t) || paging_map_identity(phys, h->length, 0) < 0) return 0;
+    return h;
+}
+
 static const acpi_rsdp_t* scan_rsdp_area(uint32_t start, uint32_t end){
     // scan 16-byte aligned
     for (uint32_t p=start; p<end; p+=16){
@@ -53,14 +64,14 @@ static const acpi_rsdp_t* find_rsdp(void){
 static void discover_sdt_pointers(void){
     if (!g_rsdp) return;
     if (g_rsdp->revision >= 2 && g_rsdp->xsdt_address){
-        g_xsdt = (const acpi_sdt_header_t*)(uintptr_t)g_rsdp->xsdt_address;
+        g_xsdt = (g_rsdp->xsdt_address >> 32) ? 0 : map_table((uint32_t)g_rsdp->xsdt_address);
         if (g_xsdt && !acpi_table_checksum_ok(g_xsdt, g_xsdt->length)){
             serial_write("[ACPI] XSDT checksum bad, ignoring.\n");
             g_xsdt = 0;
         }
     }
     if (!g_xsdt){
-        g_rsdt = (const acpi_sdt_header_t*)(uintptr_t)g_rsdp->rsdt_address;
+        g_rsdt = map_table(g_rsdp->rsdt_address);
         if (g_rsdt && !acpi_table_checksum_ok(g_rsdt, g_rsdt->length)){
             serial_write("[ACPI] RSDT checksum bad, ignoring.\n");
             g_rsdt = 0;
@@ -73,7 +84,7 @@ static const acpi_sdt_header_t* find_table_in_rsdt(const char sig[4]){
     uint32_t count = (g_rsdt->length - sizeof(acpi_sdt_header_t)) / 4u;
     const uint32_t* ents = (const uint32_t*)((const uint8_t*)g_rsdt + sizeof(acpi_sdt_header_t));
     for (uint32_t i=0;i<count;i++){
-        const acpi_sdt_header_t* h = (const acpi_sdt_header_t*)(uintptr_t)ents[i];
+        const acpi_sdt_header_t* h = map_table(ents[i]);
         if (h && memcmp_(h->signature, sig, 4) == 0 && acpi_table_checksum_ok(h, h->length)) return h;
     }
     return 0;
@@ -84,7 +95,7 @@ static const acpi_sdt_header_t* find_table_in_xsdt(const char sig[4]){
     uint32_t count = (g_xsdt->length - sizeof(acpi_sdt_header_t)) / 8u;
     const uint64_t* ents = (const uint64_t*)((const uint8_t*)g_xsdt + sizeof(acpi_sdt_header_t));
     for (uint32_t i=0;i<count;i++){
-        const acpi_sdt_header_t* h = (const acpi_sdt_header_t*)(uintptr_t)ents[i];
+        const acpi_sdt_header_t* h = (ents[i] >> 32) ? 0 : map_table((uint32_t)ents[i]);
         if (h && memcmp_(h->signature, sig, 4) == 0 && acpi_table_checksum_ok(h, h->length)) return h;
     }
     return 0;
@@ -132,3 +143,21 @@ const acpi_sdt_header_t* acpi_get_rsdt(void){ return g_rsdt; }
 const acpi_sdt_header_t* acpi_get_xsdt(void){ return g_xsdt; }
 const acpi_madt_t* acpi_find_madt(void){ return g_madt; }
 const acpi_hpet_t* acpi_find_hpet(void){ return g_hpet; }
+
+int acpi_madt_cpus(uint8_t* apic_ids, int max){
+    if (!g_madt) return 0;
+    const uint8_t* p = (const uint8_t*)g_madt + sizeof(acpi_madt_t);
+    const uint8_t* end = (const uint8_t*)g_madt + g_madt->h.length;
+    int n = 0;
+    while (p + sizeof(acpi_madt_entry_t) <= end){
+        const acpi_madt_entry_t* e = (const acpi_madt_entry_t*)p;
+        if (e->length < sizeof(acpi_madt_entry_t) || p + e->length > end) break;
+        if (e->type == ACPI_MADT_LAPIC && e->length >= sizeof(acpi_madt_lapic_t)){
+            const acpi_madt_lapic_t* l = (const acpi_madt_lapic_t*)e;
+            if ((l->flags & (ACPI_MADT_LAPIC_ENABLED | ACPI_MADT_LAPIC_ONLINE_CAPABLE)) && n < max)
+                apic_ids[n++] = l->apic_id;
+        }
+        p += e->length;
+    }
+    return n;
+}
@@ -1,5 +1,7 @@
 #include <stdint.h>
 #include <stddef.h>
+#include "include/arch/x86/gdt.h"
+#include "include/arch/x86/smp.h"
 
 struct __attribute__((packed)) gdt_entry {
   uint16_t limit_low; uint16_t base_low; uint8_t base_mid;
@@ -18,14 +20,19 @@ struct __attribute__((packed)) tss_entry {
   uint32_t ldt;        uint16_t trap; uint16_t iomap_base;
 };
 
-static // GDT girişleri: NULL(0), KERNEL_CODE(0x08), KERNEL_DATA(0x10), TSS(0x18), USER_CODE(0x20), USER_DATA(0x28)
-struct gdt_entry gdt[6];
-static struct gdt_ptr gp;
-static struct tss_entry tss;
+// GDT girişleri: NULL(0), KERNEL_CODE(0x08), KERNEL_DATA(0x10), TSS(0x18), USER_CODE(0x20), USER_DATA(0x28), CPU(0x30)
+// Every CPU gets its own table and TSS with the same layout, so selectors are
+// identical everywhere; only the TSS base and the CPU entry's limit differ.
+struct gdt_cpu {
+  struct gdt_entry gdt[GDT_ENTRIES];
+  struct gdt_ptr gp;
+  struct tss_entry tss;
+};
+static struct gdt_cpu gdt_cpus[SMP_MAX_CPUS];
 
 extern void gdt_flush(uint32_t gp_addr);
 
-static void gdt_set(int i, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran){
+static void gdt_set(struct gdt_entry* gdt, int i, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran){
   gdt[i].limit_low = (limit & 0xFFFF);
   gdt[i].base_low  = (base & 0xFFFF);
   gdt[i].base_mid  = (base >> 16) & 0xFF;
@@ -34,42 +41,53 @@ static void gdt_set(int i, uint32_t base, uint32_t limit, uint8_t access, uint8_
   gdt[i].base_hi   = (base >> 24) & 0xFF;
 }
 
-static void write_tss(int num, uint16_t ss0, uint32_t esp0){
+static void write_tss(struct gdt_cpu* c, int num, uint16_t ss0, uint32_t esp0){
+  struct tss_entry* tss = &c->tss;
   // Zero the TSS (byte-wise to avoid packed-struct alignment warnings)
-  uint8_t* t = (uint8_t*)&tss;
-  for (size_t i = 0; i < (size_t)sizeof(tss); ++i) t[i] = 0;
+  uint8_t* t = (uint8_t*)tss;
+  for (size_t i = 0; i < (size_t)sizeof(*tss); ++i) t[i] = 0;
 
-  uint32_t base = (uint32_t)&tss;
-  uint32_t limit = sizeof(tss) - 1;
+  uint32_t base = (uint32_t)tss;
+  uint32_t limit = sizeof(*tss) - 1;
   // 0x89 = present | DPL=0 | type=Available 32-bit TSS
-  gdt_set(num, base, limit, 0x89, 0x00);
+  gdt_set(c->gdt, num, base, limit, 0x89, 0x00);
 
-  tss.ss0 = ss0; tss.esp0 = esp0;
+  tss->ss0 = ss0; tss->esp0 = esp0;
   // Set segment selectors (ring0 code/data)
-  tss.cs = 0x08; // GDT entry 1, RPL 0
-  tss.ds = tss.es = tss.fs = tss.gs = tss.ss = 0x10; // GDT entry 2, RPL 0
-  tss.iomap_base = sizeof(tss);
+  tss->cs = 0x08; // GDT entry 1, RPL 0
+  tss->ds = tss->es = tss->fs = tss->gs = tss->ss = 0x10; // GDT entry 2, RPL 0
+  tss->iomap_base = sizeof(*tss);
 }
 
 // Expose a small API to update the kernel stack top used on privilege transitions
-void tss_set_kernel_stack(unsigned int esp0){ tss.esp0 = esp0; }
+void tss_set_kernel_stack(unsigned int esp0){ gdt_cpus[smp_cpu_id()].tss.esp0 = esp0; }
 
-void gdt_init(void) {
-  gp.limit = sizeof(gdt) - 1; gp.base  = (uint32_t)&gdt;
-  gdt_set(0,0,0,0,0);
-  gdt_set(1,0,0xFFFFF,0x9A,0xCF); /* kernel code */
-  gdt_set(2,0,0xFFFFF,0x92,0xCF); /* kernel data */
+uint32_t gdt_boot_descriptor(void){ return (uint32_t)&gdt_cpus[0].gp; }
+
+void gdt_init_cpu(uint32_t cpu) {
+  struct gdt_cpu* c = &gdt_cpus[cpu];
+  c->gp.limit = sizeof(c->gdt) - 1; c->gp.base = (uint32_t)&c->gdt;
+  gdt_set(c->gdt, 0,0,0,0,0);
+  gdt_set(c->gdt, 1,0,0xFFFFF,0x9A,0xCF); /* kernel code */
+  gdt_set(c->gdt, 2,0,0xFFFFF,0x92,0xCF); /* kernel data */
   
   // Kullanıcı modu segmentleri (DPL=3)
-  gdt_set(4, 0, 0xFFFFF, 0xFA, 0xCF); /* user code */
-  gdt_set(5, 0, 0xFFFFF, 0xF2, 0xCF); /* user data */
+  gdt_set(c->gdt, 4, 0, 0xFFFFF, 0xFA, 0xCF); /* user code */
+  gdt_set(c->gdt, 5, 0, 0xFFFFF, 0xF2, 0xCF); /* user data */
+
+  // Never loaded: its byte-granular limit is the CPU index, read with lsl
+  gdt_set(c->gdt, 6, 0, cpu, 0x92, 0x00);
   
   // TSS'yi 0x18 seçicisine yerleştir (indis 3)
-  write_tss(3, 0x10, 0x0);  // SS0=0x10 (kernel data segment)
+  write_tss(c, 3, 0x10, 0x0);  // SS0=0x10 (kernel data segment)
 
-  gdt_flush((uint32_t)&gp);
+  gdt_flush((uint32_t)&c->gp);
 
   // Load TR with our TSS selector (0x18)
   uint16_t tss_sel = 0x18;
   __asm__ __volatile__("ltr %0" : : "r"(tss_sel));
 }
+
+void gdt_init(void) {
+  gdt_init_cpu(0);
+}
@@ -0,0 +1,106 @@
+#include "include/arch/x86/hpet.h"
+#include "include/arch/x86/acpi.h"
+#include "include/arch/x86/paging.h"
+#include "include/drivers/serial.h"
+#include "include/kernel/ktime.h"
+#include <stdint.h>
+
+// Register offsets (bytes from the MMIO base)
+#define HPET_REG_CAP      0x000   // [31:0] caps, [63:32] period in fs
+#define HPET_REG_CONFIG   0x010
+#define HPET_REG_COUNTER  0x0F0
+#define HPET_MMIO_SIZE    0x400
+
+#define HPET_CAP_COUNT_64 (1u << 13)
+#define HPET_CFG_ENABLE   (1u << 0)
+
+#define HPET_MAX_PERIOD_FS 100000000u  // 100ns, the spec's upper bound
+#define HPET_NS_SHIFT      22
+
+static volatile uint32_t* regs = 0;
+static uint32_t period_fs = 0;
+static uint32_t ns_mult = 0;          // ns = ticks * ns_mult >> HPET_NS_SHIFT
+static int counter_64 = 0;
+static uint32_t last_lo = 0;          // 32-bit counters: last value seen...
+static uint32_t wraps = 0;            // ...and how often it wrapped
+
+static inline uint32_t hpet_rd(uint32_t off){ return regs[off / 4]; }
+static inline void hpet_wr(uint32_t off, uint32_t v){ regs[off / 4] = v; }
+
+int hpet_init(void){
+    const acpi_hpet_t* t = acpi_find_hpet();
+    if (!t){ serial_write("[HPET] No ACPI HPET table.\n"); return -1; }
+    if (t->address.address_space_id != 0 || (t->address.address >> 32)){
+        serial_write("[HPET] Registers not in 32-bit memory space.\n");
+        return -1;
+    }
+    uint32_t base = (uint32_t)t->address.address;
+    if (paging_map_identity(base, HPET_MMIO_SIZE, PAGING_NOCACHE) < 0){
+        serial_write("[HPET] Could not map registers.\n");
+        return -1;
+    }
+    regs = (volatile uint32_t*)(uintptr_t)base;
+
+    uint32_t caps = hpet_rd(HPET_REG_CAP);
+    period_fs = hpet_rd(HPET_REG_CAP + 4);
+    if (!period_fs || period_fs > HPET_MAX_PERIOD_FS){
+        serial_write("[HPET] Bogus counter period, ignoring.\n");
+        regs = 0;
+        return -1;
+    }
+    counter_64 = (caps & HPET_CAP_COUNT_64) != 0;
+
+    // ns_mult = period_fs * 2^22 / 10^6 = (period_fs << 16) / 15625, done in
+    // two 32-bit steps so no 64-bit division is needed
+    uint32_t q = period_fs / 15625u, r = period_fs % 15625u;
+    ns_mult = (q << 16) + ((r << 16) / 15625u);
+
+    // Restart the main counter from zero
+    hpet_wr(HPET_REG_CONFIG, hpet_rd(HPET_REG_CONFIG) & ~HPET_CFG_ENABLE);
+    hpet_wr(HPET_REG_COUNTER, 0);
+    hpet_wr(HPET_REG_COUNTER + 4, 0);
+    last_lo = 0; wraps = 0;
+    hpet_wr(HPET_REG_CONFIG, hpet_rd(HPET_REG_CONFIG) | HPET_CFG_ENABLE);
+
+    serial_write("[HPET] Enabled at "); serial_write_hex(base);
+    serial_write(" freq="); serial_write_dec(hpet_frequency());
+    serial_write(counter_64 ? "Hz 64-bit\n" : "Hz 32-bit\n");
+    return 0;
+}
+
+int hpet_available(void){ return regs != 0; }
+uint32_t hpet_period_fs(void){ return period_fs; }
+
+uint32_t hpet_frequency(void){
+    // 10^15 fs per second
+    return period_fs ? (uint32_t)ktime_div_u64(1000000000000000ull, period_fs, 0) : 0;
+}
+
+uint64_t hpet_read_counter(void){
+    if (!regs) return 0;
+    if (counter_64){
+        // The halves are read separately; retry if the high half moved
+        uint32_t hi, lo;
+        do {
+            hi = hpet_rd(HPET_REG_COUNTER + 4);
+            lo = hpet_rd(HPET_REG_COUNTER);
+        } while (hi != hpet_rd(HPET_REG_COUNTER + 4));
+        return ((uint64_t)hi << 32) | lo;
+    }
+    uint32_t flags;
+    __asm__ __volatile__("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    uint32_t lo = hpet_rd(HPET_REG_COUNTER);
+    if (lo < last_lo) wraps++;
+    last_lo = lo;
+    uint64_t v = ((uint64_t)wraps << 32) | lo;
+    if (flags & 0x200) __asm__ __volatile__("sti");
+    return v;
+}
+
+void hpet_sync(void){
+    if (regs && !counter_64) (void)hpet_read_counter();
+}
+
+uint64_t hpet_ticks_to_ns(uint64_t ticks){
+    return ktime_mul_shift(ticks, ns_mult, HPET_NS_SHIFT);
+}
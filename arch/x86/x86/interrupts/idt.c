@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include "include/arch/x86/io.h"
 #include "include/arch/x86/isr.h"
+#include "include/arch/x86/lapic.h"
 
 struct __attribute__((packed)) idt_entry{
   uint16_t base_lo; uint16_t sel; uint8_t always0; uint8_t flags; uint16_t base_hi;
@@ -22,6 +23,8 @@ extern void irq10_stub(void); extern void irq11_stub(void);
 extern void irq12_stub(void); extern void irq13_stub(void);
 extern void irq14_stub(void); extern void irq15_stub(void);
 extern void syscall80_stub(void);
+extern void lapic_timer_stub(void); extern void lapic_spurious_stub(void);
+extern void tlb_shootdown_stub(void);
 
 static struct idt_entry idt[256]; static struct idt_ptr ip;
 static void (*irq_handlers[16])(void);
@@ -52,6 +55,13 @@ void irq_install_handler(uint8_t irq, void (*handler)(void)){
   if (irq < 16) irq_handlers[irq] = handler;
 }
 
+void irq_set_mask(uint8_t irq, int masked){
+  uint16_t port = irq < 8 ? 0x21 : 0xA1;
+  uint8_t bit = (uint8_t)(1u << (irq & 7));
+  uint8_t m = inb(port);
+  outb(port, masked ? (m | bit) : (m & ~bit));
+}
+
 void interrupts_enable(void){ __asm__ __volatile__("sti"); }
 void interrupts_disable(void){ __asm__ __volatile__("cli"); }
 
@@ -100,12 +110,22 @@ void idt_init(void){
   idt_set_gate(46,(uint32_t)irq14_stub,0x08,0x8E);
   idt_set_gate(47,(uint32_t)irq15_stub,0x08,0x8E);
 
+  // Local APIC timer and spurious vectors
+  idt_set_gate(LAPIC_TIMER_VECTOR,(uint32_t)lapic_timer_stub,0x08,0x8E);
+  idt_set_gate(LAPIC_SPURIOUS_VECTOR,(uint32_t)lapic_spurious_stub,0x08,0x8E);
+  idt_set_gate(LAPIC_TLB_VECTOR,(uint32_t)tlb_shootdown_stub,0x08,0x8E);
+
   // Syscall entry (int 0x80), user callable (DPL=3)
   idt_set_gate(0x80, (uint32_t)syscall80_stub, 0x08, 0xEE);
 
   idt_load((uint32_t)&ip);
 }
 
+// The table is shared; application processors only need to load it
+void idt_load_cpu(void){
+  idt_load((uint32_t)&ip);
+}
+
 void irq_handler(uint8_t irq){
   // Send EOI
   if (irq >= 8) outb(0xA0, 0x20);
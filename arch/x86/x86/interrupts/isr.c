@@ -4,26 +4,20 @@
 #include "../../../../include/kernel/sched.h"
 #include "../../../../include/kernel/bsod.h"
 #include "../../../../include/kernel/irq.h"
+#include "../../../../include/arch/x86/paging.h"
+#include "../../../../include/kernel/vm.h"
+#include "../../../../include/kernel/timer.h"
 #include <stdint.h>
 
 // forward decls from drivers
 void keyboard_irq_handler(void);
 
-static volatile unsigned int ticks = 0;
-
 void panic(const char* message){
   kernel_bsod("%s", message);
 }
 
-static void timer_tick(void){
-  ticks++;
-  if ((ticks % 100) == 0){
-    serial_write("[tick] "); serial_write_dec(ticks); serial_write("\n");
-  }
-}
-
 static void pic_unmask_timer_keyboard(void){
-  outb(0x21, 0xFC); // enable IRQ0,1
+  outb(0x21, 0xEC); // enable IRQ0,1 and IRQ4 (COM1)
   outb(0xA1, 0xFF);
 }
 
@@ -40,7 +34,14 @@ static void dump_registers(const struct isr_context* ctx){
 
 void exception_handler(uint32_t vector, uint32_t error_code, const struct isr_context* ctx){
   uint32_t cr2 = 0;
-  if (vector == 14){ __asm__ __volatile__("mov %%cr2, %0" : "=r"(cr2)); }
+  if (vector == 14){
+    __asm__ __volatile__("mov %%cr2, %0" : "=r"(cr2));
+    // Copy-on-write and demand-paged regions are fixed up and the access retried
+    if (paging_handle_fault(cr2, error_code) == 0) return;
+    if (vm_handle_fault(cr2, error_code) == 0) return;
+  }
+  // Fatal from here on: interrupt-driven serial output would never drain
+  serial_panic();
   // The CPU pushed (in order): error_code (if any), EIP, CS, EFLAGS, [ESP, SS] if privilege change.
   // We cannot reliably read EIP/CS from C without the full stack frame; log what we can.
   serial_write("[EXC] vector="); serial_write_dec(vector);
@@ -54,19 +55,19 @@ void exception_handler(uint32_t vector, uint32_t error_code, const struct isr_co
 
 // Initialization hook to be called after idt_init()
 void irq_init_basic(void){
-  irq_install_handler(0, timer_tick);
+  // IRQ0 drives the kernel tick (timer_ticks) and tickless idle accounting
+  irq_install_handler(0, timer_handler);
   irq_install_handler(1, keyboard_irq_handler);
-  // PIT 100Hz
-  uint32_t freq = 100; uint32_t div = 1193180 / freq;
-  outb(0x43, 0x36);
-  outb(0x40, div & 0xFF);
-  outb(0x40, (div >> 8) & 0xFF);
+  // COM1 input arrives by interrupt so console readers can sleep
+  irq_install_handler(4, serial_irq_handler);
+  timer_phase(TIMER_FREQ);
   pic_unmask_timer_keyboard();
+  serial_enable_irq();
 }
 
 // IRQ0 handler used by irq0_stub for preemption.
 void irq0_handler(uint32_t isr_esp) {
-  timer_tick();
+  timer_handler();
   // scheduler_on_timer_isr(isr_esp); // Temporarily disabled to prevent triple fault
 }
 
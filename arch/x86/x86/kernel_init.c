@@ -2,6 +2,7 @@
 #include <stddef.h>
 #include "include/arch/x86/multiboot2.h"
 #include "include/drivers/serial.h"
+#include "include/memory/pmm.h"
 
 #include <multiboot2.h>
 // Memory initialization
@@ -121,10 +122,6 @@ void memory_init(uint32_t mb_magic, uint32_t mb_info_addr) {
             serial_write("Initializing PMM with memory map...\r\n");
             
             // Call PMM initialization with memory map
-            // Note: We'll need to implement pmm_init to handle the memory map
-            extern void pmm_init(uint32_t mem_upper_kb, uint32_t kernel_start, 
-                               uint32_t kernel_end, void *mmap, uint32_t mmap_count);
-            
             pmm_init(mem_upper_kb, (uint32_t)&_kernel_start, (uint32_t)&_kernel_end, 
                     mmap_entries, mmap_entry_count);
         } else {
@@ -132,13 +129,10 @@ void memory_init(uint32_t mb_magic, uint32_t mb_info_addr) {
             serial_write("WARNING: No memory map available, using basic PMM initialization\r\n");
             
             // Initialize PMM with just the upper memory size
-            extern void pmm_init_basic(uint32_t mem_upper_kb, uint32_t kernel_start, 
-                                     uint32_t kernel_end);
             pmm_init_basic(mem_upper_kb, (uint32_t)&_kernel_start, (uint32_t)&_kernel_end);
         }
         
         // Mark kernel memory as used
-        extern void pmm_mark_used_region(uint32_t base, uint32_t size);
         uint32_t kernel_size = (uint32_t)&_kernel_end - (uint32_t)&_kernel_start;
         pmm_mark_used_region((uint32_t)&_kernel_start, kernel_size);
         
@@ -170,7 +164,6 @@ void memory_init(uint32_t mb_magic, uint32_t mb_info_addr) {
         serial_write_dec(mem_size_mb);
         serial_write(" MB)\r\n");
         
-        extern void pmm_init_default(uint32_t mem_upper_kb);
         pmm_init_default(default_mem_upper_kb);
     }
     
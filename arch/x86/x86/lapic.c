@@ -0,0 +1,162 @@
+#include "include/arch/x86/lapic.h"
+#include "include/arch/x86/acpi.h"
+#include "include/arch/x86/paging.h"
+#include "include/arch/x86/pit.h"
+#include "include/arch/x86/smp.h"
+#include "include/drivers/serial.h"
+#include "include/kernel/irq.h"
+#include "include/kernel/timer.h"
+#include <stdint.h>
+
+void sched_tick(void);
+
+#define LAPIC_REG_VERSION    0x030
+#define LAPIC_REG_TPR        0x080
+#define LAPIC_REG_EOI        0x0B0
+#define LAPIC_REG_SVR        0x0F0
+#define LAPIC_REG_LVT_TIMER  0x320
+#define LAPIC_REG_TIMER_INIT 0x380
+#define LAPIC_REG_TIMER_CUR  0x390
+#define LAPIC_REG_TIMER_DIV  0x3E0
+
+#define LAPIC_SVR_ENABLE     (1u << 8)
+#define LAPIC_LVT_MASKED     (1u << 16)
+#define LAPIC_TIMER_PERIODIC (1u << 17)
+#define LAPIC_TIMER_DIV_16   0x3
+
+#define IA32_APIC_BASE_MSR    0x1B
+#define IA32_APIC_BASE_ENABLE (1u << 11)
+
+#define LAPIC_CALIBRATE_MS   10
+#define LAPIC_CALIBRATE_RUNS 3
+
+static volatile uint32_t* regs = 0;
+static uint32_t timer_hz = 0;        // Timer counts per second (after the divider)
+
+static inline uint64_t rdmsr(uint32_t msr){
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t v){
+    __asm__ __volatile__("wrmsr" :: "c"(msr), "a"((uint32_t)v), "d"((uint32_t)(v >> 32)));
+}
+
+uint32_t lapic_read(uint32_t reg){ return regs[reg / 4]; }
+void lapic_write(uint32_t reg, uint32_t value){ regs[reg / 4] = value; }
+uint32_t lapic_id(void){ return regs ? lapic_read(LAPIC_REG_ID) >> 24 : 0; }
+int lapic_available(void){ return regs != 0; }
+
+void lapic_eoi(void){ lapic_write(LAPIC_REG_EOI, 0); }
+
+void lapic_enable(void){
+    wrmsr(IA32_APIC_BASE_MSR, rdmsr(IA32_APIC_BASE_MSR) | IA32_APIC_BASE_ENABLE);
+    lapic_write(LAPIC_REG_TPR, 0);
+    // LINT0/LINT1 keep the firmware's virtual-wire setup so PIC IRQs still arrive
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+}
+
+int lapic_init(void){
+    uint32_t a, b, c, d;
+    __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(1), "c"(0));
+    if (!(d & (1u << 9))){ serial_write("[LAPIC] Not present.\n"); return -1; }
+
+    const acpi_madt_t* madt = acpi_find_madt();
+    uint32_t base = madt ? madt->local_apic_addr
+                         : (uint32_t)rdmsr(IA32_APIC_BASE_MSR) & 0xFFFFF000u;
+    if (paging_map_identity(base, 0x1000, PAGING_NOCACHE) < 0){
+        serial_write("[LAPIC] Could not map registers.\n");
+        return -1;
+    }
+    regs = (volatile uint32_t*)(uintptr_t)base;
+    lapic_enable();
+
+    serial_write("[LAPIC] Enabled at "); serial_write_hex(base);
+    serial_write(" id="); serial_write_dec(lapic_id());
+    serial_write(" ver="); serial_write_hex(lapic_read(LAPIC_REG_VERSION) & 0xFF);
+    serial_write("\n");
+    return 0;
+}
+
+// ---- Timer ----
+
+static void lapic_timer_periodic(void);
+static void lapic_timer_oneshot(uint32_t counts);
+static uint32_t lapic_timer_remaining(void);
+
+static timer_device_t lapic_device = {
+    "lapic", 0, 0xFFFFFFFFu,
+    lapic_timer_periodic, lapic_timer_oneshot, lapic_timer_remaining
+};
+
+static void lapic_timer_periodic(void){
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_VECTOR | LAPIC_TIMER_PERIODIC);
+    lapic_write(LAPIC_REG_TIMER_INIT, lapic_device.counts_per_tick);
+}
+
+static void lapic_timer_oneshot(uint32_t counts){
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_REG_TIMER_INIT, counts ? counts : 1);
+}
+
+static uint32_t lapic_timer_remaining(void){
+    return lapic_read(LAPIC_REG_TIMER_CUR);
+}
+
+// Timer counts over LAPIC_CALIBRATE_MS, timed by PIT channel 2
+static uint32_t measure(void){
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_VECTOR | LAPIC_LVT_MASKED);
+    pit_ch2_start(LAPIC_CALIBRATE_MS);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0xFFFFFFFFu);
+    while (!pit_ch2_expired()) { }
+    uint32_t left = lapic_read(LAPIC_REG_TIMER_CUR);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0);
+    pit_ch2_stop();
+    return 0xFFFFFFFFu - left;
+}
+
+int lapic_timer_init(void){
+    if (!regs) return -1;
+
+    uint32_t flags;
+    __asm__ __volatile__("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    uint32_t best = 0;
+    for (int i = 0; i < LAPIC_CALIBRATE_RUNS; i++){
+        uint32_t n = measure();
+        if (!best || n < best) best = n;
+    }
+    if (flags & 0x200) __asm__ __volatile__("sti");
+
+    timer_hz = best * (1000u / LAPIC_CALIBRATE_MS);
+    lapic_device.counts_per_tick = timer_hz / TIMER_FREQ;
+    if (!lapic_device.counts_per_tick){
+        serial_write("[LAPIC] Timer calibration failed.\n");
+        return -1;
+    }
+
+    // The LAPIC timer takes over the tick; silence the PIT on the PIC
+    irq_set_mask(0, 1);
+    timer_set_device(&lapic_device);
+
+    serial_write("[LAPIC] Timer "); serial_write_dec(timer_hz);
+    serial_write(" Hz, "); serial_write_dec(lapic_device.counts_per_tick);
+    serial_write(" counts/tick\n");
+    return 0;
+}
+
+void lapic_timer_start(void){
+    if (regs && lapic_device.counts_per_tick) lapic_timer_periodic();
+}
+
+uint32_t lapic_timer_frequency(void){ return timer_hz; }
+
+void lapic_timer_interrupt(void){
+    lapic_eoi();
+    // Every CPU slices its own threads; only the boot CPU keeps time
+    if (smp_cpu_id() == 0) timer_handler();
+    sched_tick();
+}
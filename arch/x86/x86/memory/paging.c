@@ -2,37 +2,249 @@
 #include "include/drivers/serial.h"
 #include "include/memory/pmm.h"
 #include "include/arch/x86/paging.h"
+#include "include/kernel/kheap.h"
+#include "include/gui/display.h"
+#include "include/kernel/types.h"
+#include "include/kernel/ktime.h"
+#include "include/arch/x86/smp.h"
+#include "include/arch/x86/lapic.h"
+#include "include/kernel/spinlock.h"
 
-#define PAGE_PRESENT 0x001
-#define PAGE_RW      0x002
-#define PAGE_USER    0x004
+#define PAGE_PRESENT PAGING_PRESENT
+#define PAGE_RW      PAGING_RW
+#define PAGE_USER    PAGING_USER
+#define PAGE_PS      0x080   // PDE maps a 4MB page directly (needs CR4.PSE)
+#define PAGE_COW     0x200   // available bit: read-only because shared copy-on-write
+
+#define PF_PRESENT   0x1     // page-fault error code: protection violation
+#define PF_WRITE     0x2     // page-fault error code: write access
+
+#define CR4_PSE      0x010
+
+// Ranges longer than this are flushed with a CR3 reload instead of invlpg
+#define TLB_INVLPG_MAX 32u
+
+#if PAGING_SCRATCH_SLOTS < SMP_MAX_CPUS
+#error "one scratch page per CPU is needed"
+#endif
 
 static uint32_t __attribute__((aligned(4096))) page_directory[1024];
 static uint32_t __attribute__((aligned(4096))) first_page_table[1024];
-// Map the kernel heap high region (e.g., 0xC0000000..)
-static uint32_t __attribute__((aligned(4096))) heap_page_table[1024];
 
-extern void* kmalloc(unsigned long size);
+static int pse_enabled = 0;
+static uint32_t large_pages = 0;   // 4MB PDEs currently installed
+
+// Reference directory for the kernel half; every address space shares its
+// kernel PDEs (same page tables), so kernel mappings are set up only once
+page_directory_t* kernel_directory = page_directory;
+
+// Directory whose physical address is in CR3
+// Directory loaded on each CPU
+static uint32_t* cpu_dir[SMP_MAX_CPUS];
+#define current_dir cpu_dir[smp_cpu_id()]
+
+// Per-process directories live in one page-table-sized window of kernel
+// virtual space; slot i is mapped at PAGING_DIR_AREA + i * 4KB
+static uint32_t dir_phys[PAGING_MAX_DIRS];
+static uint32_t dir_count = 0;
+// CPUs that have slot i loaded in CR3 (bit n = CPU n)
+static volatile uint32_t dir_cpus[PAGING_MAX_DIRS];
+
+static paging_switch_stats_t switch_stats;
+
+extern uint32_t _kernel_end;
+
+// The last PDE maps the page directory onto itself, so every page table is
+// reachable at PT_WINDOW + pd_idx * 4KB regardless of where its frame lives
+#define PD_RECURSIVE_IDX 1023u
+#define PT_WINDOW 0xFFC00000u
 
 static inline void invlpg(void* addr){ __asm__ __volatile__("invlpg (%0)" :: "r"(addr) : "memory"); }
 
+static inline uint32_t* pt_window(uint32_t pd_idx){ return (uint32_t*)(PT_WINDOW + (pd_idx << 12)); }
+
+static inline void load_cr3(uint32_t phys){ __asm__ __volatile__("mov %0, %%cr3" :: "r"(phys) : "memory"); }
+
+static inline uint32_t* dir_slot_va(uint32_t slot){ return (uint32_t*)(PAGING_DIR_AREA + (slot << 12)); }
+
+// Kernel PDEs: the whole kernel half plus whatever low slots the kernel
+// directory maps itself (identity map, framebuffer)
+static inline int is_kernel_pde(uint32_t pd_idx){
+    return pd_idx >= PAGING_KERNEL_PDE || (page_directory[pd_idx] & PAGE_PRESENT);
+}
+
+// Write a PDE in the current directory; kernel PDEs go to the reference
+// directory and every live process directory so the kernel half stays shared
+static void pde_set(uint32_t pd_idx, uint32_t value){
+    if (current_dir != page_directory && !is_kernel_pde(pd_idx)){
+        current_dir[pd_idx] = value;
+        return;
+    }
+    page_directory[pd_idx] = value;
+    for (uint32_t i = 0; i < PAGING_MAX_DIRS; i++){
+        if (dir_phys[i]) dir_slot_va(i)[pd_idx] = value;
+    }
+}
+
+static inline void flush_tlb(void){
+    uint32_t cr3;
+    __asm__ __volatile__("mov %%cr3, %0; mov %0, %%cr3" : "=r"(cr3) :: "memory");
+}
+
+static int dir_slot(const uint32_t* dir);
+
+// ---- TLB shootdown ----
+//
+// One request is in flight at a time. The initiator fills in the range,
+// sets a bit per target CPU in tlb_pending and sends the IPI; each target
+// flushes and clears its bit. pages == 0 flushes the whole TLB. 'drop'
+// asks CPUs that still have that directory loaded to leave it for the
+// kernel directory before it is freed.
+static volatile int tlb_busy = 0;
+static volatile uint32_t tlb_pending = 0;
+static volatile uint32_t tlb_va, tlb_pages;
+static uint32_t* volatile tlb_drop;
+
+static void tlb_flush_request(void){
+    uint32_t bit = 1u << smp_cpu_id();
+    if (!(tlb_pending & bit)) return;
+    __sync_synchronize();
+    if (tlb_drop && current_dir == tlb_drop) paging_switch_directory(NULL);
+    if (!tlb_pages || tlb_pages > TLB_INVLPG_MAX) flush_tlb();
+    else for (uint32_t i = 0; i < tlb_pages; i++) invlpg((void*)(tlb_va + (i << 12)));
+    __sync_fetch_and_and(&tlb_pending, ~bit);
+}
+
+void paging_tlb_poll(void){
+    if (tlb_pending) tlb_flush_request();
+}
+
+void paging_tlb_interrupt(void){
+    tlb_flush_request();
+    lapic_eoi();
+}
+
+// Other online CPUs
+static uint32_t other_cpus(void){
+    uint32_t mask = 0, self = smp_cpu_id();
+    for (uint32_t i = 0; i < smp_cpu_present(); i++){
+        cpu_t* c = smp_cpu(i);
+        if (i != self && c && c->online) mask |= 1u << i;
+    }
+    return mask;
+}
+
+// CPUs that may cache translations under PDE 'pd_idx' of the current
+// directory: kernel PDEs are shared by every CPU, user PDEs only by the
+// CPUs running on this directory
+static uint32_t tlb_cpus(uint32_t pd_idx){
+    if (is_kernel_pde(pd_idx)) return other_cpus();
+    int slot = dir_slot(current_dir);
+    return slot < 0 ? 0 : dir_cpus[slot] & other_cpus();
+}
+
+static void tlb_shootdown(uint32_t cpus, uint32_t va, uint32_t pages, uint32_t* drop){
+    if (!cpus || !lapic_available()) return;
+    uint32_t flags = irq_save();
+    // Keep answering other initiators while waiting for our turn
+    while (__sync_lock_test_and_set(&tlb_busy, 1)){
+        paging_tlb_poll();
+        __asm__ __volatile__("pause");
+    }
+    tlb_va = va;
+    tlb_pages = pages;
+    tlb_drop = drop;
+    __sync_fetch_and_or(&tlb_pending, cpus);
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++){
+        if (cpus & (1u << i)) smp_send_ipi(i, LAPIC_TLB_VECTOR);
+    }
+    while (tlb_pending & cpus) __asm__ __volatile__("pause");
+    tlb_drop = NULL;
+    __sync_lock_release(&tlb_busy);
+    irq_restore(flags);
+}
+
+// CPUID.01h:EDX bit 3 advertises 4MB pages
+static int cpu_has_pse(void){
+    uint32_t eax = 1, ebx, ecx = 0, edx;
+    __asm__ __volatile__("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+    return (edx >> 3) & 1;
+}
+
+// Replace a 4MB PDE with a page table mapping the same frames, so a single
+// 4KB page inside it can be changed. Returns -1 if no frame for the table.
+static int split_large(uint32_t pd_idx){
+    uint32_t pde = current_dir[pd_idx];
+    uint32_t frame = pmm_alloc_frame();
+    if (!frame) return -1;
+    uint32_t flags = pde & (PAGE_PRESENT | PAGE_RW | PAGE_USER);
+    uint32_t base = pde & ~(PAGING_LARGE_SIZE - 1);
+    // Build the table through the window only after the PDE points at it
+    pde_set(pd_idx, frame | flags);
+    flush_tlb();
+    uint32_t* pt = pt_window(pd_idx);
+    for (uint32_t i = 0; i < 1024; i++) pt[i] = (base + (i << 12)) | flags;
+    flush_tlb();
+    large_pages--;
+    return 0;
+}
+
+// Identity-map the linear framebuffer: whole aligned 4MB slots as large
+// pages, ragged head/tail (or everything without PSE) as 4KB pages
+static void map_framebuffer(void){
+    if (!current_mode.addr || !current_mode.pitch || !current_mode.height) return;
+    uint32_t start = (uint32_t)current_mode.addr & ~0xFFFu;
+    uint32_t end = (uint32_t)current_mode.addr + current_mode.pitch * current_mode.height;
+    end = (end + 0xFFFu) & ~0xFFFu;
+    if (end <= start) return;
+    if (start < kheap_limit() && end > KHEAP_START){
+        serial_write("[Paging] Framebuffer overlaps the kernel heap window, not mapped\n");
+        return;
+    }
+    for (uint32_t va = start; va < end && va < PAGING_SCRATCH_BASE; ){
+        if (end - va >= PAGING_LARGE_SIZE && paging_map_large(va, va, 0) == 0){
+            va += PAGING_LARGE_SIZE;
+            continue;
+        }
+        paging_map_page(va, va);
+        va += 0x1000;
+    }
+}
+
 void paging_init(void){
     // Zero PD and PT
     for (int i = 0; i < 1024; ++i){ page_directory[i] = 0; first_page_table[i] = 0; }
+    for (int i = 0; i < SMP_MAX_CPUS; ++i) cpu_dir[i] = page_directory;
 
-    // Identity-map first 4MB as user-accessible so simple userspace can run
-    for (int i = 0; i < 1024; ++i){
-        first_page_table[i] = (i * 0x1000) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
+    if (cpu_has_pse()){
+        uint32_t cr4;
+        __asm__ __volatile__("mov %%cr4, %0" : "=r"(cr4));
+        cr4 |= CR4_PSE;
+        __asm__ __volatile__("mov %0, %%cr4" :: "r"(cr4));
+        pse_enabled = 1;
     }
-    page_directory[0] = ((uint32_t)first_page_table) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
 
-    // Map a 1MB kernel heap at virtual 0xC0000000 to physical 4MB..5MB
-    // PDE index for 0xC0000000 is 0x300
-    for (int i = 0; i < 256; ++i) { // 256 * 4KB = 1MB
-        heap_page_table[i] = ((0x400000 + (i * 0x1000)) & ~0xFFFu) | PAGE_PRESENT | PAGE_RW; // supervisor RW
+    if (pse_enabled){
+        // Identity-map the kernel image with 4MB pages, user-accessible like
+        // the 4KB layout below so simple userspace keeps running
+        uint32_t end = ((uint32_t)&_kernel_end + PAGING_LARGE_SIZE - 1) & ~(PAGING_LARGE_SIZE - 1);
+        for (uint32_t pa = 0; pa < end; pa += PAGING_LARGE_SIZE){
+            page_directory[pa >> 22] = pa | PAGE_PS | PAGE_PRESENT | PAGE_RW | PAGE_USER;
+            large_pages++;
+        }
+    } else {
+        // Identity-map first 4MB as user-accessible so simple userspace can run
+        for (int i = 0; i < 1024; ++i){
+            first_page_table[i] = (i * 0x1000) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
+        }
+        page_directory[0] = ((uint32_t)first_page_table) | PAGE_PRESENT | PAGE_RW | PAGE_USER;
     }
-    for (int i = 256; i < 1024; ++i) heap_page_table[i] = 0; // clear rest
-    page_directory[0x300] = ((uint32_t)heap_page_table) | PAGE_PRESENT | PAGE_RW;
+
+    // The kernel heap at 0xC0000000 (PDE 0x300) starts empty; kheap maps
+    // PMM frames (or whole 4MB pages) into it on demand
+
+    // Recursive slot for reaching page tables after paging is on
+    page_directory[PD_RECURSIVE_IDX] = ((uint32_t)page_directory) | PAGE_PRESENT | PAGE_RW;
 
     // Load CR3
     __asm__ __volatile__("mov %0, %%cr3" :: "r"(page_directory));
@@ -41,30 +253,361 @@ void paging_init(void){
     uint32_t cr0;
     __asm__ __volatile__("mov %%cr0, %0" : "=r"(cr0));
     cr0 |= 0x80000000u; // PG
+    cr0 |= 0x00010000u; // WP: kernel writes to read-only (COW) user pages fault too
     __asm__ __volatile__("mov %0, %%cr0" :: "r"(cr0));
 
-    serial_write("[Paging] Enabled with identity map (4MB) + heap at 0xC0000000 (1MB).\n");
+    map_framebuffer();
+
+    if (pse_enabled) serial_write("[Paging] Enabled with 4MB pages (PSE) + on-demand heap at 0xC0000000.\n");
+    else serial_write("[Paging] Enabled with identity map (4MB) + on-demand heap at 0xC0000000.\n");
 }
 
-// Map a single 4KB page at 'virt' to 'phys' with RW kernel perms
-void paging_map_page(uint32_t virt, uint32_t phys){
+int paging_pse_enabled(void){ return pse_enabled; }
+uint32_t paging_large_page_count(void){ return large_pages; }
+
+// Map a 4MB page at 'virt' to 'phys' (both 4MB aligned). 'user' sets the
+// user bit. Returns -1 without PSE, on misalignment, or if the slot is
+// already in use, so the caller can fall back to 4KB pages.
+int paging_map_large(uint32_t virt, uint32_t phys, int user){
+    if (!pse_enabled) return -1;
+    if ((virt | phys) & (PAGING_LARGE_SIZE - 1)) return -1;
+    uint32_t pd_idx = virt >> 22;
+    if (pd_idx == PD_RECURSIVE_IDX || (current_dir[pd_idx] & PAGE_PRESENT)) return -1;
+    pde_set(pd_idx, phys | PAGE_PS | PAGE_PRESENT | PAGE_RW | (user ? PAGE_USER : 0));
+    large_pages++;
+    invlpg((void*)virt);
+    return 0;
+}
+
+// Remove a 4MB mapping; returns its physical base (0 if 'virt' is not
+// covered by a large page)
+uint32_t paging_unmap_large(uint32_t virt){
+    uint32_t pd_idx = virt >> 22;
+    uint32_t pde = current_dir[pd_idx];
+    if ((pde & (PAGE_PRESENT | PAGE_PS)) != (PAGE_PRESENT | PAGE_PS)) return 0;
+    pde_set(pd_idx, 0);
+    large_pages--;
+    flush_tlb();
+    tlb_shootdown(tlb_cpus(pd_idx), virt & ~(PAGING_LARGE_SIZE - 1), 0, NULL);
+    return pde & ~(PAGING_LARGE_SIZE - 1);
+}
+
+int paging_is_large(uint32_t virt){
+    uint32_t pde = current_dir[virt >> 22];
+    return (pde & (PAGE_PRESENT | PAGE_PS)) == (PAGE_PRESENT | PAGE_PS);
+}
+
+// Map a single 4KB page at 'virt' to 'phys' in the current address space.
+// 'flags' is PAGING_RW and/or PAGING_USER. Returns 0 on success, -1 if a
+// page table could not be allocated.
+int paging_map_page_flags(uint32_t virt, uint32_t phys, uint32_t flags){
     uint32_t pd_idx = (virt >> 22) & 0x3FF;
     uint32_t pt_idx = (virt >> 12) & 0x3FF;
-    uint32_t pde = page_directory[pd_idx];
-    uint32_t* pt;
-    if (!(pde & PAGE_PRESENT)){
-        // allocate a new page table
-        pt = (uint32_t*)kmalloc(4096);
-        // zero it
-        for (int i=0;i<1024;i++) pt[i]=0;
-        page_directory[pd_idx] = ((uint32_t)pt) | PAGE_PRESENT | PAGE_RW; // supervisor RW
-        // reload CR3 to flush TLB for new PT
-        __asm__ __volatile__("mov %0, %%cr3" :: "r"(page_directory));
-    } else {
-        pt = (uint32_t*)(pde & ~0xFFFu);
+    uint32_t* pt = pt_window(pd_idx);
+    flags &= PAGE_RW | PAGE_USER | PAGING_NOCACHE;
+    if (current_dir[pd_idx] & PAGE_PS){
+        if (split_large(pd_idx) < 0) return -1;
+    }
+    if (!(current_dir[pd_idx] & PAGE_PRESENT)){
+        // allocate a new page table frame and clear it through the window
+        uint32_t frame = pmm_alloc_frame();
+        if (!frame) return -1;
+        pde_set(pd_idx, (frame & ~0xFFFu) | PAGE_PRESENT | PAGE_RW | (flags & PAGE_USER));
+        invlpg(pt);
+        for (int i = 0; i < 1024; i++) pt[i] = 0;
+    } else if ((flags & PAGE_USER) && !(current_dir[pd_idx] & PAGE_USER) && !is_kernel_pde(pd_idx)){
+        pde_set(pd_idx, current_dir[pd_idx] | PAGE_USER);
     }
-    pt[pt_idx] = (phys & ~0xFFFu) | PAGE_PRESENT | PAGE_RW;
+    pt[pt_idx] = (phys & ~0xFFFu) | PAGE_PRESENT | flags;
     invlpg((void*)virt);
+    return 0;
 }
 
-// (no exports)
+// Map a single 4KB page at 'virt' to 'phys' with RW kernel perms.
+int paging_map_page(uint32_t virt, uint32_t phys){
+    return paging_map_page_flags(virt, phys, PAGE_RW);
+}
+
+// Remove the mapping at 'virt' from this CPU's TLB only
+static uint32_t unmap_local(uint32_t virt){
+    uint32_t pd_idx = (virt >> 22) & 0x3FF;
+    uint32_t pt_idx = (virt >> 12) & 0x3FF;
+    if (!(current_dir[pd_idx] & PAGE_PRESENT)) return 0;
+    if ((current_dir[pd_idx] & PAGE_PS) && split_large(pd_idx) < 0) return 0;
+    uint32_t* pt = pt_window(pd_idx);
+    uint32_t pte = pt[pt_idx];
+    if (!(pte & PAGE_PRESENT)) return 0;
+    pt[pt_idx] = 0;
+    invlpg((void*)virt);
+    return pte & ~0xFFFu;
+}
+
+// Remove the mapping at 'virt'; returns the physical frame it pointed to (0 if none).
+// Other CPUs drop the translation before this returns, so the frame can be freed.
+uint32_t paging_unmap_page(uint32_t virt){
+    uint32_t frame = unmap_local(virt);
+    if (frame) tlb_shootdown(tlb_cpus(virt >> 22), virt & ~0xFFFu, 1, NULL);
+    return frame;
+}
+
+// Translate a mapped virtual address; returns 0 if not mapped
+uint32_t paging_get_phys(uint32_t virt){
+    uint32_t pd_idx = (virt >> 22) & 0x3FF;
+    uint32_t pde = current_dir[pd_idx];
+    if (!(pde & PAGE_PRESENT)) return 0;
+    if (pde & PAGE_PS) return (pde & ~(PAGING_LARGE_SIZE - 1)) | (virt & (PAGING_LARGE_SIZE - 1));
+    uint32_t pte = pt_window(pd_idx)[(virt >> 12) & 0x3FF];
+    if (!(pte & PAGE_PRESENT)) return 0;
+    return (pte & ~0xFFFu) | (virt & 0xFFFu);
+}
+
+// Does any page in [start, end) have a translation? Absent page tables are
+// skipped a whole 4MB slot at a time
+int paging_range_mapped(uint32_t start, uint32_t end){
+    for (uint32_t va = start & ~0xFFFu; va < end; ){
+        uint32_t pd_idx = (va >> 22) & 0x3FF;
+        uint32_t pde = current_dir[pd_idx];
+        if (pde & PAGE_PRESENT){
+            if (pde & PAGE_PS) return 1;
+            if (pt_window(pd_idx)[(va >> 12) & 0x3FF] & PAGE_PRESENT) return 1;
+            va += 0x1000;
+        } else {
+            va = (va & ~(PAGING_LARGE_SIZE - 1)) + PAGING_LARGE_SIZE;
+        }
+        if (!va) break; // wrapped past 4GB
+    }
+    return 0;
+}
+
+// Identity-map [phys, phys+size) for the kernel: firmware tables and device
+// registers (pass PAGING_NOCACHE for MMIO). Pages already mapped are kept.
+int paging_map_identity(uint32_t phys, uint32_t size, uint32_t flags){
+    uint32_t start = phys & ~0xFFFu;
+    uint32_t last = (phys + (size ? size - 1 : 0)) & ~0xFFFu;
+    if (last < start || last >= PAGING_SCRATCH_BASE) return -1;
+    if (start < kheap_limit() && last >= KHEAP_START) return -1;
+    for (uint32_t va = start; ; va += 0x1000){
+        if (paging_get_phys(va) != va &&
+            paging_map_page_flags(va, va, PAGE_RW | (flags & PAGING_NOCACHE)) < 0) return -1;
+        if (va == last) break;
+    }
+    return 0;
+}
+
+// Map 'frame' at this CPU's scratch page so its contents can be edited.
+// Callers keep interrupts off until scratch_unmap() so they stay on this
+// CPU. No other CPU touches the slot, so only the local TLB is flushed.
+static void* scratch_map(uint32_t frame){
+    uint32_t va = PAGING_SCRATCH_VA(smp_cpu_id());
+    if (paging_map_page(va, frame) < 0) return NULL;
+    return (void*)va;
+}
+
+static void scratch_unmap(void){ unmap_local(PAGING_SCRATCH_VA(smp_cpu_id())); }
+
+// ---- Per-process address spaces ----
+
+uint32_t* paging_kernel_directory(void){ return page_directory; }
+uint32_t* paging_current_directory(void){ return current_dir; }
+
+static int dir_slot(const uint32_t* dir){
+    uint32_t off = (uint32_t)dir - PAGING_DIR_AREA;
+    if ((uint32_t)dir < PAGING_DIR_AREA || off >= (PAGING_MAX_DIRS << 12)) return -1;
+    return (int)(off >> 12);
+}
+
+// New address space: the user half starts empty, the kernel half points at
+// the very same page tables as the kernel directory. Costs one frame.
+uint32_t* paging_create_directory(void){
+    uint32_t slot;
+    for (slot = 0; slot < PAGING_MAX_DIRS && dir_phys[slot]; slot++) {}
+    if (slot == PAGING_MAX_DIRS) return NULL;
+
+    uint32_t frame = pmm_alloc_frame();
+    if (!frame) return NULL;
+    uint32_t* dir = dir_slot_va(slot);
+    if (paging_map_page((uint32_t)dir, frame) < 0){
+        pmm_free_frame(frame);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < PD_RECURSIVE_IDX; i++){
+        dir[i] = is_kernel_pde(i) ? page_directory[i] : 0;
+    }
+    dir[PD_RECURSIVE_IDX] = frame | PAGE_PRESENT | PAGE_RW;
+    // Register last so pde_set never sees a half-built directory
+    dir_phys[slot] = frame;
+    dir_count++;
+    return dir;
+}
+
+// Free a directory, its private page tables and the frames they map.
+// Must not be the current directory of the calling CPU.
+void paging_destroy_directory(uint32_t* dir){
+    int slot = dir_slot(dir);
+    if (slot < 0 || !dir_phys[slot] || dir == current_dir) return;
+
+    // Kernel threads keep running on whatever directory is loaded, so other
+    // CPUs may still have this one in CR3: move them to the kernel directory
+    // before any of its frames go back to the PMM
+    tlb_shootdown(dir_cpus[slot] & other_cpus(), 0, 0, dir);
+
+    // Reach each private table through this CPU's scratch page
+    for (uint32_t i = 0; i < PD_RECURSIVE_IDX; i++){
+        uint32_t pde = dir[i];
+        if (!(pde & PAGE_PRESENT) || is_kernel_pde(i)) continue;
+        if (pde & PAGE_PS){
+            pmm_free_frames(pde & ~(PAGING_LARGE_SIZE - 1), PAGING_LARGE_SIZE >> 12);
+            continue;
+        }
+        uint32_t flags = irq_save();
+        const uint32_t* pt = (const uint32_t*)scratch_map(pde & ~0xFFFu);
+        if (pt){
+            for (uint32_t j = 0; j < 1024; j++){
+                if (pt[j] & PAGE_PRESENT) pmm_free_frame(pt[j] & ~0xFFFu);
+            }
+            scratch_unmap();
+        }
+        irq_restore(flags);
+        pmm_free_frame(pde & ~0xFFFu);
+    }
+
+    uint32_t frame = dir_phys[slot];
+    dir_phys[slot] = 0;
+    dir_count--;
+    paging_unmap_page((uint32_t)dir);
+    pmm_free_frame(frame);
+}
+
+// Load 'dir' (NULL = kernel directory) into CR3. Switching to the directory
+// that is already loaded is skipped, which keeps the TLB warm when threads
+// of the same process (or kernel threads) follow each other.
+void paging_switch_directory(uint32_t* dir){
+    if (!dir) dir = page_directory;
+    if (dir == current_dir){
+        switch_stats.skipped++;
+        return;
+    }
+    uint32_t cpu = smp_cpu_id();
+    uint32_t phys;
+    int slot = -1;
+    if (dir == page_directory) phys = (uint32_t)page_directory;
+    else {
+        slot = dir_slot(dir);
+        if (slot < 0 || !dir_phys[slot]) return;
+        phys = dir_phys[slot];
+    }
+    // Mark the new directory before loading it and clear the old one only
+    // after, so a shootdown never misses a CPU that may hold translations
+    int old = dir_slot(cpu_dir[cpu]);
+    if (slot >= 0) __sync_fetch_and_or(&dir_cpus[slot], 1u << cpu);
+    uint64_t t0 = ktime_cycles();
+    load_cr3(phys);
+    cpu_dir[cpu] = dir;
+    if (old >= 0) __sync_fetch_and_and(&dir_cpus[old], ~(1u << cpu));
+    uint32_t cycles = (uint32_t)(ktime_cycles() - t0);
+    switch_stats.switches++;
+    switch_stats.last_cycles = cycles;
+    switch_stats.total_cycles += cycles;
+}
+
+void paging_get_switch_stats(paging_switch_stats_t* out){
+    if (!out) return;
+    *out = switch_stats;
+    out->directories = dir_count;
+}
+
+// ---- Copy-on-write ----
+
+static uint32_t cow_stats_shared = 0;   // PTEs turned COW by paging_cow_clone
+static uint32_t cow_stats_copied = 0;   // faults resolved with a private copy
+static uint32_t cow_stats_reused = 0;   // faults where the last sharer kept the frame
+
+// Share the user half of the current directory with 'dst' copy-on-write:
+// writable user pages become read-only + COW in both, every mapped frame
+// gains a reference. Only page tables are copied, never page contents.
+int paging_cow_clone(uint32_t* dst){
+    if (!dst || dst == current_dir) return -1;
+    uint32_t irq = irq_save();
+    int ret = 0;
+    for (uint32_t i = 0; i < PD_RECURSIVE_IDX; i++){
+        uint32_t pde = current_dir[i];
+        if (!(pde & PAGE_PRESENT) || is_kernel_pde(i) || (pde & PAGE_PS)) continue;
+
+        uint32_t frame = pmm_alloc_frame();
+        if (!frame){ ret = -1; break; }
+        uint32_t* child = (uint32_t*)scratch_map(frame);
+        if (!child){ pmm_free_frame(frame); ret = -1; break; }
+
+        uint32_t* parent = pt_window(i);
+        for (uint32_t j = 0; j < 1024; j++){
+            uint32_t pte = parent[j];
+            if (pte & PAGE_PRESENT){
+                if (pte & PAGE_RW){
+                    pte = (pte & ~PAGE_RW) | PAGE_COW;
+                    parent[j] = pte;
+                    cow_stats_shared++;
+                }
+                pmm_frame_ref(pte & ~0xFFFu);
+            }
+            child[j] = pte;
+        }
+        scratch_unmap();
+        dst[i] = frame | (pde & 0xFFFu);
+    }
+    // Parent mappings just lost their write bit, here and on every CPU
+    // running on this directory
+    flush_tlb();
+    int slot = dir_slot(current_dir);
+    if (slot >= 0) tlb_shootdown(dir_cpus[slot] & other_cpus(), 0, 0, NULL);
+    irq_restore(irq);
+    return ret;
+}
+
+// Write fault on a COW page: the last sharer just regains write access,
+// otherwise the page is copied into a private frame
+static int cow_fault(uint32_t addr){
+    uint32_t pd_idx = addr >> 22;
+    uint32_t pde = current_dir[pd_idx];
+    if (!(pde & PAGE_PRESENT) || (pde & PAGE_PS)) return -1;
+    uint32_t* pte = &pt_window(pd_idx)[(addr >> 12) & 0x3FF];
+    if ((*pte & (PAGE_PRESENT | PAGE_COW)) != (PAGE_PRESENT | PAGE_COW)) return -1;
+
+    uint32_t page = addr & ~0xFFFu;
+    uint32_t old = *pte & ~0xFFFu;
+    uint32_t flags = (*pte & 0xFFFu & ~PAGE_COW) | PAGE_RW;
+    if (pmm_frame_refcount(old) == 1){
+        *pte = old | flags;
+        invlpg((void*)page);
+        cow_stats_reused++;
+        return 0;
+    }
+
+    uint32_t frame = pmm_alloc_frame();
+    if (!frame) return -1;
+    uint8_t* dst = (uint8_t*)scratch_map(frame);
+    if (!dst){ pmm_free_frame(frame); return -1; }
+    const uint8_t* src = (const uint8_t*)page;
+    for (uint32_t i = 0; i < 0x1000; i++) dst[i] = src[i];
+    scratch_unmap();
+
+    *pte = frame | flags;
+    invlpg((void*)page);
+    pmm_free_frame(old);
+    cow_stats_copied++;
+    return 0;
+}
+
+// Called from the page-fault exception; returns 0 if the fault was resolved
+// and the faulting instruction can simply be restarted
+int paging_handle_fault(uint32_t addr, uint32_t error_code){
+    if ((error_code & (PF_PRESENT | PF_WRITE)) == (PF_PRESENT | PF_WRITE)){
+        return cow_fault(addr);
+    }
+    return -1;
+}
+
+void paging_get_cow_stats(uint32_t* shared, uint32_t* copied, uint32_t* reused){
+    if (shared) *shared = cow_stats_shared;
+    if (copied) *copied = cow_stats_copied;
+    if (reused) *reused = cow_stats_reused;
+}
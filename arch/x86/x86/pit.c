@@ -0,0 +1,23 @@
+#include "include/arch/x86/pit.h"
+#include "include/arch/x86/io.h"
+#include <stdint.h>
+
+static uint8_t saved_gate;
+
+void pit_ch2_start(uint32_t ms){
+    uint32_t count = PIT_BASE_HZ / 1000u * ms;
+    if (count > 0xFFFF) count = 0xFFFF;
+    saved_gate = inb(0x61);
+    outb(0x61, (saved_gate & ~0x02) | 0x01);   // gate on, speaker off
+    outb(0x43, 0xB0);                          // channel 2, lobyte/hibyte, mode 0
+    outb(0x42, count & 0xFF);
+    outb(0x42, (count >> 8) & 0xFF);
+}
+
+int pit_ch2_expired(void){
+    return (inb(0x61) & 0x20) != 0;            // OUT2 goes high at terminal count
+}
+
+void pit_ch2_stop(void){
+    outb(0x61, saved_gate);
+}
@@ -0,0 +1,145 @@
+#include "include/arch/x86/smp.h"
+#include "include/arch/x86/acpi.h"
+#include "include/arch/x86/gdt.h"
+#include "include/arch/x86/idt.h"
+#include "include/arch/x86/lapic.h"
+#include "include/arch/x86/paging.h"
+#include "include/arch/x86/pit.h"
+#include "include/drivers/serial.h"
+#include "kernel/thread.h"
+#include "kernel/sched.h"
+#include <string.h>
+#include <stdint.h>
+
+// ICR fields for the INIT-SIPI-SIPI sequence
+#define ICR_INIT             0x00000500u
+#define ICR_STARTUP          0x00000600u
+#define ICR_DELIVERY_PENDING 0x00001000u
+#define ICR_LEVEL_ASSERT     0x00004000u
+#define ICR_TRIGGER_LEVEL    0x00008000u
+
+#define AP_START_TIMEOUT_MS  100
+
+// Filled in before each SIPI; see the data block in smp_trampoline.S
+typedef struct __attribute__((packed)) {
+    uint16_t gdt_limit;
+    uint32_t gdt_base;
+    uint32_t cr3;
+    uint32_t cr4;
+    uint32_t stack;
+    uint32_t entry;
+    uint32_t cpu;
+} smp_trampoline_data_t;
+
+extern uint8_t smp_trampoline_start[];
+extern uint8_t smp_trampoline_data[];
+extern uint8_t smp_trampoline_end[];
+
+static cpu_t cpus[SMP_MAX_CPUS];
+static uint32_t cpus_present = 1;
+static volatile uint32_t cpus_online = 1;
+
+uint32_t smp_cpu_count(void){ return cpus_online; }
+uint32_t smp_cpu_present(void){ return cpus_present; }
+cpu_t* smp_cpu(uint32_t index){ return index < cpus_present ? &cpus[index] : 0; }
+
+static void delay_ms(uint32_t ms){
+    pit_ch2_start(ms);
+    while (!pit_ch2_expired()) { }
+    pit_ch2_stop();
+}
+
+static void send_ipi(uint32_t apic_id, uint32_t icr){
+    lapic_write(LAPIC_REG_ICR_HI, apic_id << 24);
+    lapic_write(LAPIC_REG_ICR_LO, icr);
+    while (lapic_read(LAPIC_REG_ICR_LO) & ICR_DELIVERY_PENDING) { }
+}
+
+void smp_send_ipi(uint32_t index, uint8_t vector){
+    if (index >= cpus_present || !cpus[index].online) return;
+    send_ipi(cpus[index].apic_id, ICR_LEVEL_ASSERT | vector);
+}
+
+// First C code on an AP, running on its idle thread's stack
+static void ap_main(uint32_t index){
+    cpu_t* c = &cpus[index];
+    gdt_init_cpu(index);
+    idt_load_cpu();
+    lapic_enable();
+
+    c->online = 1;
+    __sync_fetch_and_add(&cpus_online, 1);
+
+    // Own tick for time slices, then schedule from this CPU's run queue
+    lapic_timer_start();
+    sched_ap_main(c->idle);
+}
+
+static int start_ap(cpu_t* c, smp_trampoline_data_t* data){
+    data->stack = (uint32_t)c->idle->stack;
+    data->entry = (uint32_t)ap_main;
+    data->cpu = c->index;
+    __sync_synchronize();
+
+    // INIT (assert, then de-assert for older parts), then two SIPIs
+    send_ipi(c->apic_id, ICR_INIT | ICR_LEVEL_ASSERT | ICR_TRIGGER_LEVEL);
+    send_ipi(c->apic_id, ICR_INIT | ICR_TRIGGER_LEVEL);
+    delay_ms(10);
+    for (int i = 0; i < 2 && !c->online; i++){
+        send_ipi(c->apic_id, ICR_STARTUP | ICR_LEVEL_ASSERT | (SMP_TRAMPOLINE_BASE >> 12));
+        delay_ms(1);
+    }
+
+    for (int ms = 0; ms < AP_START_TIMEOUT_MS && !c->online; ms++) delay_ms(1);
+    return c->online ? 0 : -1;
+}
+
+void smp_init(void){
+    uint32_t bsp = lapic_id();
+    cpus[0].index = 0;
+    cpus[0].apic_id = bsp;
+    cpus[0].online = 1;
+    if (!lapic_available()) return;
+
+    uint8_t ids[SMP_MAX_CPUS * 2];
+    int n = acpi_madt_cpus(ids, (int)sizeof(ids));
+    for (int i = 0; i < n && cpus_present < SMP_MAX_CPUS; i++){
+        if (ids[i] == bsp) continue;
+        cpu_t* c = &cpus[cpus_present];
+        c->index = cpus_present;
+        c->apic_id = ids[i];
+        c->online = 0;
+        cpus_present++;
+    }
+    if (cpus_present == 1){
+        serial_write("[SMP] Single CPU.\n");
+        return;
+    }
+
+    // The trampoline page sits in reserved, identity-mapped low memory
+    uint8_t* tramp = (uint8_t*)(uintptr_t)SMP_TRAMPOLINE_BASE;
+    memcpy(tramp, smp_trampoline_start, (size_t)(smp_trampoline_end - smp_trampoline_start));
+    smp_trampoline_data_t* data =
+        (smp_trampoline_data_t*)(tramp + (smp_trampoline_data - smp_trampoline_start));
+
+    const uint8_t* gp = (const uint8_t*)(uintptr_t)gdt_boot_descriptor();
+    memcpy(&data->gdt_limit, gp, 2);
+    memcpy(&data->gdt_base, gp + 2, 4);
+    data->cr3 = (uint32_t)paging_kernel_directory();
+    __asm__ __volatile__("mov %%cr4, %0" : "=r"(data->cr4));
+
+    for (uint32_t i = 1; i < cpus_present; i++){
+        cpu_t* c = &cpus[i];
+        c->idle = thread_create_idle();
+        if (!c->idle){ serial_write("[SMP] Out of memory for idle threads.\n"); break; }
+        if (start_ap(c, data) < 0){
+            serial_write("[SMP] CPU "); serial_write_dec(c->index);
+            serial_write(" (APIC "); serial_write_dec(c->apic_id);
+            serial_write(") did not start\n");
+        }
+    }
+
+    serial_write("[SMP] "); serial_write_dec(cpus_online);
+    serial_write(" of "); serial_write_dec(cpus_present);
+    serial_write(" CPUs online\n");
+}
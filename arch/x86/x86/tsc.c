@@ -0,0 +1,82 @@
+#include "include/arch/x86/tsc.h"
+#include "include/arch/x86/hpet.h"
+#include "include/arch/x86/pit.h"
+#include "include/drivers/serial.h"
+#include "include/kernel/ktime.h"
+#include <stdint.h>
+
+#define TSC_NS_SHIFT       22
+#define TSC_CALIBRATE_MS   10
+#define TSC_CALIBRATE_RUNS 3
+
+static int present = 0;
+static int invariant = 0;
+static uint32_t khz = 0;
+static uint32_t ns_mult = 0;    // ns = cycles * ns_mult >> TSC_NS_SHIFT
+
+static void cpuid(uint32_t leaf, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d){
+    __asm__ __volatile__("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "a"(leaf), "c"(0));
+}
+
+// Cycles elapsed over TSC_CALIBRATE_MS measured on the HPET
+static uint64_t measure_hpet(void){
+    uint64_t target = (uint64_t)TSC_CALIBRATE_MS * NSEC_PER_MSEC;
+    uint64_t h0 = hpet_read_counter();
+    uint64_t t0 = ktime_cycles();
+    uint64_t h1, t1;
+    do {
+        h1 = hpet_read_counter();
+        t1 = ktime_cycles();
+    } while (hpet_ticks_to_ns(h1 - h0) < target);
+    // Normalise to exactly TSC_CALIBRATE_MS
+    uint32_t ns = (uint32_t)hpet_ticks_to_ns(h1 - h0);
+    return ktime_div_u64((t1 - t0) * (uint64_t)target, ns, 0);
+}
+
+// Cycles elapsed over TSC_CALIBRATE_MS on PIT channel 2 (speaker gate, mode 0)
+static uint64_t measure_pit(void){
+    pit_ch2_start(TSC_CALIBRATE_MS);
+    uint64_t t0 = ktime_cycles();
+    while (!pit_ch2_expired()) { }
+    uint64_t t1 = ktime_cycles();
+    pit_ch2_stop();
+    return t1 - t0;
+}
+
+int tsc_init(void){
+    uint32_t a, b, c, d;
+    cpuid(0, &a, &b, &c, &d);
+    if (a < 1) return -1;
+    cpuid(1, &a, &b, &c, &d);
+    if (!(d & (1u << 4))){ serial_write("[TSC] Not supported.\n"); return -1; }
+    present = 1;
+    cpuid(0x80000000, &a, &b, &c, &d);
+    if (a >= 0x80000007){
+        cpuid(0x80000007, &a, &b, &c, &d);
+        invariant = (d & (1u << 8)) != 0;
+    }
+
+    // Shortest run wins: interrupts and SMIs only ever make a run longer
+    uint64_t best = 0;
+    for (int i = 0; i < TSC_CALIBRATE_RUNS; i++){
+        uint64_t cyc = hpet_available() ? measure_hpet() : measure_pit();
+        if (!best || cyc < best) best = cyc;
+    }
+    khz = (uint32_t)ktime_div_u64(best, TSC_CALIBRATE_MS, 0);
+    if (!khz){ present = 0; return -1; }
+    // ns_mult = 10^6 * 2^22 / khz
+    ns_mult = (uint32_t)ktime_div_u64(1000000ull << TSC_NS_SHIFT, khz, 0);
+
+    serial_write("[TSC] "); serial_write_dec(khz);
+    serial_write(hpet_available() ? " kHz (HPET)" : " kHz (PIT)");
+    serial_write(invariant ? " invariant\n" : " not invariant\n");
+    return 0;
+}
+
+int tsc_available(void){ return present; }
+int tsc_invariant(void){ return invariant; }
+uint32_t tsc_khz(void){ return khz; }
+
+uint64_t tsc_cycles_to_ns(uint64_t cycles){
+    return ktime_mul_shift(cycles, ns_mult, TSC_NS_SHIFT);
+}
@@ -1,6 +1,7 @@
 #include "include/arch/x86/io.h"
 #include "include/drivers/serial.h"
 #include "include/drivers/keyboard.h"
+#include "include/kernel/console.h"
 #include <stdint.h>
 
 #define KBD_DATA 0x60
@@ -45,7 +46,7 @@ static char scancode_to_ascii(uint8_t sc){
 
 void keyboard_init(void){ head = tail = 0; shift_l = shift_r = caps = 0; e0_pending = 0; }
 
-static inline void push_key(uint16_t key){ unsigned int n = (head + 1) % BUF_SIZE; if (n != tail){ ring[head] = key; head = n; } }
+static inline void push_key(uint16_t key){ unsigned int n = (head + 1) % BUF_SIZE; if (n != tail){ ring[head] = key; head = n; } console_input_notify(); }
 
 int keyboard_getkey_nonblock(void){ if (head == tail) return -1; uint16_t k = ring[tail]; tail = (tail + 1) % BUF_SIZE; return (int)k; }
 
@@ -78,6 +79,8 @@ void keyboard_irq_handler(void){
             case 0x47: push_key(KBD_HOME); return;   // Home
             case 0x4F: push_key(KBD_END); return;    // End
             case 0x53: push_key(KBD_DEL); return;    // Delete
+            case 0x49: push_key(KBD_PGUP); return;   // Page Up
+            case 0x51: push_key(KBD_PGDN); return;   // Page Down
             default: return;
         }
     }
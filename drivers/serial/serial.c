@@ -1,8 +1,27 @@
 #include "include/arch/x86/io.h"
 #include <stddef.h>
 #include <stdint.h>
+#include "include/kernel/console.h"
+#include "include/kernel/spinlock.h"
 #define COM1 0x3F8
+#define SERIAL_RX_SIZE 256
+#define SERIAL_TX_SIZE 4096
+#define UART_FIFO_SIZE 16
+// Interrupt enable bits
+#define IER_RX  0x01
+#define IER_TX  0x02
 static int serial_ready = 0;
+// Bytes received by IRQ4, consumed by serial_getchar_nonblock()
+static volatile uint8_t rx_ring[SERIAL_RX_SIZE];
+static volatile uint32_t rx_head = 0, rx_tail = 0;
+static volatile int rx_irq = 0;
+// Bytes waiting to be sent. Writers append under tx_lock and return;
+// IRQ4 refills the UART FIFO whenever it runs empty.
+static volatile uint8_t tx_ring[SERIAL_TX_SIZE];
+static volatile uint32_t tx_head = 0, tx_tail = 0;
+static volatile int tx_irq = 0;      // Transmit side is interrupt driven
+static volatile int tx_busy = 0;     // THR-empty interrupt is armed
+static spinlock_t tx_lock = SPINLOCK_INIT("serial-tx");
 void serial_init(void){
   // Disable all interrupts
   outb(COM1 + 1, 0x00);
@@ -46,14 +65,57 @@ void serial_init(void){
 }
 static int is_transmit_empty(){ return inb(COM1 + 5) & 0x20; }
 static int serial_data_ready(){ return inb(COM1 + 5) & 0x01; }
-static void serial_putc(char ch){
-  if(!serial_ready) return;
+static void serial_putc_sync(char ch){
   while(!is_transmit_empty()) { }
   outb(COM1, (uint8_t)ch);
 }
-void serial_write(const char* s){
+static uint8_t ier_bits(void){ return (rx_irq ? IER_RX : 0) | (tx_busy ? IER_TX : 0); }
+
+// Move up to one FIFO's worth from the ring into the UART; tx_lock held
+static void tx_fill_fifo(void){
+  if (!is_transmit_empty()) return;
+  for (int i = 0; i < UART_FIFO_SIZE && tx_tail != tx_head; i++) {
+    outb(COM1, tx_ring[tx_tail]);
+    tx_tail = (tx_tail + 1) % SERIAL_TX_SIZE;
+  }
+}
+
+// Append to the TX ring and make sure the UART is draining it. A full
+// ring is drained by the caller itself, so writers never wait on an
+// interrupt (they may be running with interrupts off).
+static void tx_enqueue(const char* s, size_t len){
+  uint32_t flags = spin_lock_irqsave(&tx_lock);
+  for (size_t i = 0; i < len; i++) {
+    uint32_t n = (tx_head + 1) % SERIAL_TX_SIZE;
+    if (n == tx_tail) {
+      serial_putc_sync((char)tx_ring[tx_tail]);
+      tx_tail = (tx_tail + 1) % SERIAL_TX_SIZE;
+    }
+    tx_ring[tx_head] = (uint8_t)s[i];
+    tx_head = n;
+  }
+  if (!tx_busy) {
+    tx_fill_fifo();
+    tx_busy = 1;
+    outb(COM1 + 1, ier_bits());
+  }
+  spin_unlock_irqrestore(&tx_lock, flags);
+}
+
+static void serial_putc(char ch){
   if(!serial_ready) return;
-  for(size_t i=0; s[i]; i++) serial_putc(s[i]);
+  if (tx_irq) tx_enqueue(&ch, 1);
+  else serial_putc_sync(ch);
+}
+void serial_write_buf(const char* s, size_t len){
+  if(!serial_ready) return;
+  if (tx_irq) { tx_enqueue(s, len); return; }
+  for(size_t i=0; i<len; i++) serial_putc_sync(s[i]);
+}
+void serial_write(const char* s){
+  size_t len = 0;
+  while (s[len]) len++;
+  serial_write_buf(s, len);
 }
 void serial_write_hex(unsigned int v){
   const char* hex = "0123456789ABCDEF";
@@ -67,9 +129,62 @@ void serial_write_dec(unsigned int v){
   while (i--) serial_putc(buf[i]);
 }
 
+// IRQ4: drain the receive FIFO into the ring and wake console readers,
+// then refill the transmit FIFO or disarm the THR-empty interrupt
+void serial_irq_handler(void){
+  int received = 0;
+  while (serial_data_ready()) {
+    uint8_t b = inb(COM1);
+    uint32_t n = (rx_head + 1) % SERIAL_RX_SIZE;
+    if (n != rx_tail) { rx_ring[rx_head] = b; rx_head = n; }
+    received = 1;
+  }
+  if (received) console_input_notify();
+
+  if (!tx_irq) return;
+  spin_lock(&tx_lock);
+  if (tx_busy) {
+    tx_fill_fifo();
+    if (tx_tail == tx_head && is_transmit_empty()) {
+      tx_busy = 0;
+      outb(COM1 + 1, ier_bits());
+    }
+  }
+  spin_unlock(&tx_lock);
+}
+
+// Switch from polling to the receive and transmit interrupts; IRQ4 must
+// be routed
+void serial_enable_irq(void){
+  if(!serial_ready) return;
+  rx_irq = 1;
+  tx_irq = 1;
+  outb(COM1 + 1, ier_bits());
+}
+
+// Panic path: stop using interrupts, push out whatever is still queued
+// and write synchronously from here on. The lock is ignored on purpose;
+// its holder may be the CPU that crashed.
+void serial_panic(void){
+  if(!serial_ready) return;
+  tx_irq = 0;
+  tx_busy = 0;
+  outb(COM1 + 1, 0x00);
+  while (tx_tail != tx_head) {
+    serial_putc_sync((char)tx_ring[tx_tail]);
+    tx_tail = (tx_tail + 1) % SERIAL_TX_SIZE;
+  }
+}
+
 // Non-blocking input read; returns -1 if no byte available
 int serial_getchar_nonblock(void){
   if(!serial_ready) return -1;
+  if (rx_irq) {
+    if (rx_head == rx_tail) return -1;
+    uint8_t b = rx_ring[rx_tail];
+    rx_tail = (rx_tail + 1) % SERIAL_RX_SIZE;
+    return (int)b;
+  }
   if (!serial_data_ready()) return -1;
   return (int)(uint8_t)inb(COM1);
 }
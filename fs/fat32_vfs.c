@@ -36,6 +36,7 @@ static vfs_node_t* fat32_create_node(const char* name, uint32_t size, int is_dir
     node.name[VFS_NAME_MAX - 1] = '\0';
     node.size = size;
     node.flags = is_dir ? VFS_DIRECTORY : VFS_FILE;
+    node.inode = cluster; // first cluster identifies the file on the volume
 
     node.read = fat32_read;
     node.write = fat32_write;
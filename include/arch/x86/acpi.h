@@ -39,6 +39,23 @@ typedef struct {
     // followed by variable records
 } acpi_madt_t;
 
+// MADT record header; 'length' covers the whole record
+typedef struct {
+    uint8_t type;
+    uint8_t length;
+} acpi_madt_entry_t;
+
+#define ACPI_MADT_LAPIC                0   // Processor Local APIC
+#define ACPI_MADT_LAPIC_ENABLED        0x1
+#define ACPI_MADT_LAPIC_ONLINE_CAPABLE 0x2
+
+typedef struct {
+    acpi_madt_entry_t h;
+    uint8_t  acpi_id;
+    uint8_t  apic_id;
+    uint32_t flags;
+} acpi_madt_lapic_t;
+
 // HPET table
 typedef struct {
     acpi_sdt_header_t h;
@@ -68,6 +85,9 @@ const acpi_sdt_header_t* acpi_get_rsdt(void);
 const acpi_sdt_header_t* acpi_get_xsdt(void);
 const acpi_madt_t* acpi_find_madt(void);
 const acpi_hpet_t* acpi_find_hpet(void);
+// Walk the MADT processor records: store up to 'max' APIC IDs of usable
+// CPUs (enabled or online-capable) and return how many were found.
+int acpi_madt_cpus(uint8_t* apic_ids, int max);
 
 // Utility
 int acpi_table_checksum_ok(const void* table, uint32_t length);
@@ -1,3 +1,13 @@
 #pragma once
+#include <stdint.h>
+
+#define GDT_ENTRIES 7
+// Per-CPU descriptor whose limit holds the CPU index (see smp_cpu_id)
+#define GDT_CPU_SEL 0x30
+
 void gdt_init(void);
+// Build and load the calling CPU's own GDT and TSS
+void gdt_init_cpu(uint32_t cpu);
+// Address of the boot CPU's GDT descriptor, loaded by the AP trampoline
+uint32_t gdt_boot_descriptor(void);
 void tss_set_kernel_stack(unsigned int esp0);
@@ -0,0 +1,22 @@
+#pragma once
+#include <stdint.h>
+
+// High Precision Event Timer: free-running main counter used as clocksource
+
+// Map the MMIO block found by acpi_init() and start the main counter.
+// Returns 0 on success, -1 if there is no usable HPET.
+int hpet_init(void);
+int hpet_available(void);
+
+// Main counter, extended to 64 bits in software on 32-bit-only parts
+uint64_t hpet_read_counter(void);
+
+// Counter period in femtoseconds and its frequency in Hz
+uint32_t hpet_period_fs(void);
+uint32_t hpet_frequency(void);
+
+// Convert counter ticks to nanoseconds (multiply/shift, no division)
+uint64_t hpet_ticks_to_ns(uint64_t ticks);
+
+// Sample a 32-bit counter often enough to notice every wrap (no-op on 64-bit)
+void hpet_sync(void);
@@ -3,3 +3,5 @@
 void interrupts_enable(void);
 void interrupts_disable(void);
 void idt_init(void);
+// Load the already built IDT on the calling CPU
+void idt_load_cpu(void);
@@ -1,17 +1,18 @@
 #pragma once
 #include <stdint.h>
 
-// Saved general-purpose registers as laid out by pusha/pushal
-// Order matches the stack layout after pushal: EAX, ECX, EDX, EBX, ESP, EBP, ESI, EDI
+// Saved general-purpose registers as laid out by pusha/pushal.
+// pushal pushes EAX first, so in memory (lowest address first) they read
+// EDI, ESI, EBP, ESP, EBX, EDX, ECX, EAX; the CPU's iret frame follows.
 struct isr_context {
-	uint32_t eax;
-	uint32_t ecx;
-	uint32_t edx;
-	uint32_t ebx;
-	uint32_t esp; // original ESP at exception entry (before pushal)
-	uint32_t ebp;
-	uint32_t esi;
 	uint32_t edi;
+	uint32_t esi;
+	uint32_t ebp;
+	uint32_t esp; // original ESP at exception entry (before pushal)
+	uint32_t ebx;
+	uint32_t edx;
+	uint32_t ecx;
+	uint32_t eax;
 };
 
 void exception_handler(uint32_t vector, uint32_t error_code, const struct isr_context* ctx);
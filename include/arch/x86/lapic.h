@@ -0,0 +1,36 @@
+#pragma once
+#include <stdint.h>
+
+// Local APIC: per-CPU interrupt controller and timer
+
+#define LAPIC_TIMER_VECTOR    0x40
+#define LAPIC_TLB_VECTOR      0x41   // TLB shootdown IPI
+#define LAPIC_SPURIOUS_VECTOR 0xFF
+
+// Register offsets used outside the driver (IPIs)
+#define LAPIC_REG_ID      0x020
+#define LAPIC_REG_ICR_LO  0x300
+#define LAPIC_REG_ICR_HI  0x310
+
+// Map the LAPIC (MADT address, else IA32_APIC_BASE) and enable it on the
+// boot CPU. Returns 0 on success, -1 if the CPU has no usable APIC.
+int lapic_init(void);
+int lapic_available(void);
+
+// Enable the calling CPU's LAPIC (spurious vector, TPR); used by every CPU
+void lapic_enable(void);
+
+uint32_t lapic_read(uint32_t reg);
+void lapic_write(uint32_t reg, uint32_t value);
+uint32_t lapic_id(void);
+void lapic_eoi(void);
+
+// Calibrate the LAPIC timer against the PIT and make it the tick source
+// (periodic at TIMER_FREQ, one-shot for tickless idle); the PIT IRQ is masked.
+int lapic_timer_init(void);
+// Start the calibrated timer on the calling CPU
+void lapic_timer_start(void);
+uint32_t lapic_timer_frequency(void);
+
+// Called from the vector stubs in isr.S
+void lapic_timer_interrupt(void);
@@ -1,4 +1,62 @@
 #pragma once
 #include <stdint.h>
 
-void paging_init(void); 
\ No newline at end of file
+// Size of a PSE large page
+#define PAGING_LARGE_SIZE 0x400000u
+
+// Page table entry flags accepted by paging_map_page_flags
+#define PAGING_PRESENT 0x001u
+#define PAGING_RW      0x002u
+#define PAGING_USER    0x004u
+#define PAGING_NOCACHE 0x018u   // PWT|PCD: device registers
+
+// PDEs from here up (0xC0000000..) belong to the kernel in every address space
+#define PAGING_KERNEL_PDE 0x300u
+// Window that keeps every process page directory mapped (PDE 1022)
+#define PAGING_DIR_AREA   0xFF800000u
+#define PAGING_MAX_DIRS   1024u
+// Kernel pages used to reach a frame that is not otherwise mapped, one per
+// CPU (slot i sits right below slot i-1), so CPUs never remap each other's
+#define PAGING_SCRATCH_SLOTS 8u
+#define PAGING_SCRATCH_BASE  (PAGING_DIR_AREA - PAGING_SCRATCH_SLOTS * 0x1000u)
+#define PAGING_SCRATCH_VA(cpu) (PAGING_DIR_AREA - ((cpu) + 1u) * 0x1000u)
+
+typedef struct {
+    uint32_t switches;        // CR3 reloads
+    uint32_t skipped;         // switches to the already loaded directory
+    uint32_t last_cycles;     // TSC cycles of the last CR3 reload
+    uint64_t total_cycles;
+    uint32_t directories;     // live process directories
+} paging_switch_stats_t;
+
+void paging_init(void);
+int paging_map_page(uint32_t virt, uint32_t phys);
+int paging_map_page_flags(uint32_t virt, uint32_t phys, uint32_t flags);
+uint32_t paging_unmap_page(uint32_t virt);
+uint32_t paging_get_phys(uint32_t virt);
+int paging_map_identity(uint32_t phys, uint32_t size, uint32_t flags);
+int paging_range_mapped(uint32_t start, uint32_t end);
+
+int paging_pse_enabled(void);
+int paging_map_large(uint32_t virt, uint32_t phys, int user);
+uint32_t paging_unmap_large(uint32_t virt);
+int paging_is_large(uint32_t virt);
+uint32_t paging_large_page_count(void);
+
+uint32_t* paging_kernel_directory(void);
+uint32_t* paging_current_directory(void);
+uint32_t* paging_create_directory(void);
+void paging_destroy_directory(uint32_t* dir);
+void paging_switch_directory(uint32_t* dir);
+void paging_get_switch_stats(paging_switch_stats_t* out);
+
+// TLB shootdown: every other CPU that may cache a changed translation is
+// sent an IPI and the initiator waits for all of them to flush
+void paging_tlb_interrupt(void);   // called from the vector stub in isr.S
+// CPUs spinning with interrupts off call this so a pending shootdown can
+// still complete (its initiator may hold the lock they wait for)
+void paging_tlb_poll(void);
+
+int paging_cow_clone(uint32_t* dst);
+int paging_handle_fault(uint32_t addr, uint32_t error_code);
+void paging_get_cow_stats(uint32_t* shared, uint32_t* copied, uint32_t* reused);
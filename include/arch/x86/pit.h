@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+
+// 8253/8254 PIT channel 2 as a calibration stopwatch (speaker gate, mode 0).
+// Channel 0 stays with the kernel tick in kernel/timer.c.
+
+#define PIT_BASE_HZ 1193180u
+
+// Start a countdown of 'ms' milliseconds (at most 54)
+void pit_ch2_start(uint32_t ms);
+// Non-zero once the countdown reached zero
+int pit_ch2_expired(void);
+// Restore the speaker gate
+void pit_ch2_stop(void);
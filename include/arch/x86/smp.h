@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+#include "include/arch/x86/gdt.h"
+
+// Symmetric multiprocessing: application processor (AP) bring-up
+
+#define SMP_MAX_CPUS        8
+// Real-mode trampoline page; the SIPI vector is its page number
+#define SMP_TRAMPOLINE_BASE 0x8000u
+
+struct thread;
+
+typedef struct cpu {
+    uint32_t index;          // Logical CPU number, 0 is the boot CPU
+    uint32_t apic_id;        // Local APIC ID from the MADT
+    volatile int online;     // Set by the CPU itself once it runs kernel code
+    struct thread* idle;     // Thread that runs when nothing else is ready
+} cpu_t;
+
+// Start every usable AP listed in the MADT; safe without an APIC (one CPU)
+void smp_init(void);
+uint32_t smp_cpu_count(void);     // CPUs online
+uint32_t smp_cpu_present(void);   // CPUs listed in the MADT (at least 1)
+cpu_t* smp_cpu(uint32_t index);
+// Send interrupt 'vector' to the online CPU 'index'
+void smp_send_ipi(uint32_t index, uint8_t vector);
+
+// Index of the calling CPU: the limit of its GDT_CPU_SEL entry. lsl leaves
+// the register alone before the GDT is loaded, which reads as CPU 0.
+static inline uint32_t smp_cpu_id(void){
+    uint32_t id = 0;
+    __asm__ __volatile__("lsl %1, %0" : "+r"(id) : "r"((uint32_t)GDT_CPU_SEL) : "cc");
+    return id;
+}
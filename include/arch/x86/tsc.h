@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+
+// Time Stamp Counter calibration
+
+// Detect the TSC and measure its frequency against the HPET (or PIT
+// channel 2 when there is no HPET). Returns 0 on success.
+int tsc_init(void);
+
+int tsc_available(void);
+// Constant rate across P-/C-states (CPUID 0x80000007 EDX[8])
+int tsc_invariant(void);
+uint32_t tsc_khz(void);
+
+uint64_t tsc_cycles_to_ns(uint64_t cycles);
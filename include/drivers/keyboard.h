@@ -15,6 +15,8 @@ enum {
     KBD_HOME  = 0x105,
     KBD_END   = 0x106,
     KBD_DEL   = 0x107,
+    KBD_PGUP  = 0x108,
+    KBD_PGDN  = 0x109,
 };
 
 // Returns ASCII for printable keys and special codes above (>= KBD_KEY_BASE) for navigation keys.
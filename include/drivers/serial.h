@@ -1,6 +1,13 @@
 #pragma once
+#include <stddef.h>
 void serial_init(void);
+// Output is queued and sent by IRQ4 once serial_enable_irq() ran
 void serial_write(const char* s);
+void serial_write_buf(const char* s, size_t len);
 void serial_write_hex(unsigned int v);
 void serial_write_dec(unsigned int v);
 int  serial_getchar_nonblock(void);
+void serial_enable_irq(void);
+void serial_irq_handler(void);
+// Flush and fall back to polled output (kernel_bsod)
+void serial_panic(void);
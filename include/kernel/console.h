@@ -45,12 +45,25 @@ typedef struct {
 void console_init(void);
 void console_putc(char c);
 void console_puts(const char* str);
+// Bulk output for write(2) on stdout/stderr
+void console_write(const char* str, size_t len);
 void console_clear(void);
 void console_set_attr(uint8_t attr);
 void console_set_color(uint8_t fg, uint8_t bg);
 void console_scroll(void);
+// Page through the RAM scrollback; negative moves back towards live output
+void console_scrollback(int lines);
 void console_put_hex(uint32_t n);
 void console_put_dec(uint32_t n);
 void kprintf(const char* fmt, ...);
+// Panic screen: stop taking the console lock (its holder may have crashed)
+void console_panic(void);
+
+// Console input from the keyboard or COM1 (CR becomes LF). The drivers'
+// interrupt handlers call console_input_notify() for every byte queued;
+// console_getchar() sleeps until one is available.
+int console_getchar(void);
+int console_getchar_nonblock(void);
+void console_input_notify(void);
 
 #endif // _KERNEL_CONSOLE_H
@@ -61,6 +61,16 @@ typedef struct {
 // Dönüş değeri: Giriş noktası adresi veya NULL (hata durumunda)
 void* elf_load(const void* data, size_t size);
 
+// Kullanıcı yığını: çekirdek yarısının hemen altında, talep üzerine sıfırla dolar
+#define ELF_USER_STACK_TOP  0xBFFFF000u
+#define ELF_USER_STACK_SIZE 0x20000u   // 128KB
+#define ELF_MAX_PHDRS       16
+
+// ELF segmentlerini ve kullanıcı yığınını verilen adres alanına tembel
+// bölgeler olarak kaydet; dosyanın tamamı okunmaz
+// Dönüş değeri: 0 (giriş noktası *entry'de) veya -1 (hata durumunda)
+int elf_map(const char* filename, uint32_t* dir, uint32_t* entry);
+
 // ELF dosyasını yükle ve yeni bir işlem olarak başlat
 // Parametreler:
 //   - filename: Yüklenecek ELF dosyasının adı
@@ -30,6 +30,9 @@ void irq_init(void);
 // Register an IRQ handler (implemented in arch-specific code)
 void irq_install_handler(uint8_t irq, void (*handler)(void));
 
+// Mask (1) or unmask (0) a line on the 8259 PIC
+void irq_set_mask(uint8_t irq, int masked);
+
 // Unregister an IRQ handler (not implemented in kernel/irq.c)
 // void irq_uninstall_handler(uint8_t irq);
 
@@ -6,18 +6,71 @@
 
 // Kernel heap başlangıç adresi
 #define KHEAP_START 0xC0000000
-#define KHEAP_INITIAL_SIZE 0x100000  // 1MB başlangıç boyutu
+#define KHEAP_INITIAL_SIZE 0x10000   // 64KB başlangıç boyutu (talep üzerine büyür)
+
+// Heap'in büyüyebileceği üst sınır (derleme anında -DKHEAP_MAX_SIZE=... ile
+// veya çalışırken kheap_set_max() ile değiştirilebilir; en fazla
+// PAGING_SCRATCH_BASE'e kadar)
+#ifndef KHEAP_MAX_SIZE
+#define KHEAP_MAX_SIZE 0x10000000    // 256MB
+#endif
+
+// Sondaki boş blok bu kadar sayfayı aşınca sayfalar PMM'e geri verilir
+#define KHEAP_TRIM_THRESHOLD 0x10000 // 64KB
 
 // Hizalama değeri
 #define KHEAP_ALIGN 0x1000
 
-// Bellek blok başlığı
+// 4MB sınırındaki büyüme en az bu kadarsa (ve PSE varsa) tek bir 4MB
+// büyük sayfa ile karşılanır; TLB baskısını azaltır
+#define KHEAP_LARGE_GROW 0x100000    // 1MB
+
+// Küçük nesneler için boyut sınıfları (16, 32, ... 2048 byte)
+#define KHEAP_MIN_CLASS_SHIFT 4
+#define KHEAP_NUM_CLASSES 8
+#define KHEAP_MAX_SMALL (1u << (KHEAP_MIN_CLASS_SHIFT + KHEAP_NUM_CLASSES - 1))
+
+// Slab parçası boyutu (her sınıf için tek seferde ayrılan alan)
+#define KHEAP_SLAB_CHUNK 0x1000
+
+// Başlık etiketleri: kfree() işaretçinin hemen önündeki kelimeye bakarak
+// bloğun slab nesnesi mi yoksa büyük blok mu olduğunu anlar
+#define KHEAP_BLOCK_MAGIC 0x4B48424Cu  // "KHBL"
+#define KHEAP_SLAB_MAGIC  0x534C4200u  // "SLB" + sınıf indeksi (düşük byte)
+
+// Büyük blok boş listeleri: bin i, [2^i, 2^(i+1)) boyutlu blokları tutar
+#define KHEAP_NUM_BINS 32
+
+// Büyük bloklar için başlık (sınır etiketi). Boşken bin listesine bağlıdır.
 typedef struct heap_block {
-    struct heap_block* next;
-    size_t size;
-    uint8_t used;
+    size_t size;               // yük boyutu (başlık ve alt etiket hariç)
+    uint32_t used;
+    struct heap_block* next;   // bin içindeki sonraki boş blok (LIFO)
+    struct heap_block* prev;   // bin içindeki önceki boş blok
+    uint32_t magic;            // her zaman son alan: KHEAP_BLOCK_MAGIC
 } heap_block_t;
 
+// Büyük blokların alt etiketi: yükün hemen arkasında, başlığı gösterir
+typedef struct heap_footer {
+    heap_block_t* header;
+} heap_footer_t;
+
+// Slab nesne başlığı
+typedef struct kheap_slab_obj {
+    struct kheap_slab_obj* next; // yalnızca nesne boştayken geçerli
+    uint32_t tag;                // KHEAP_SLAB_MAGIC | sınıf indeksi
+} kheap_slab_obj_t;
+
+// Boyut sınıfı istatistikleri
+typedef struct {
+    uint32_t obj_size;    // sınıfın nesne boyutu
+    uint32_t chunks;      // büyük ayırıcıdan alınan slab parçası sayısı
+    uint32_t total;       // toplam nesne kapasitesi
+    uint32_t in_use;      // kullanılan nesne sayısı
+    uint32_t allocs;      // toplam kmalloc sayısı
+    uint32_t frees;       // toplam kfree sayısı
+} kheap_class_stats_t;
+
 // Kernel heap yapısı
 typedef struct {
     uint32_t start_address;
@@ -36,4 +89,12 @@ void kfree(void* ptr);
 void* krealloc(void* ptr, size_t size);
 void* kcalloc(size_t num, size_t size);
 
+// Büyüme sınırı (bayt, KHEAP_START'tan itibaren)
+int kheap_set_max(uint32_t max_size);
+uint32_t kheap_limit(void);
+
+// İstatistikler
+int kheap_get_class_stats(int cls, kheap_class_stats_t* out);
+void kalloc_dump(void);
+
 #endif // _KERNEL_KHEAP_H
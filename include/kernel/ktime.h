@@ -0,0 +1,54 @@
+#ifndef _KERNEL_KTIME_H
+#define _KERNEL_KTIME_H
+
+#include <stdint.h>
+
+// Monotonic kernel clock. Backed by the best clocksource found at boot:
+// an invariant TSC, then the HPET, falling back to the 10ms timer tick.
+
+#define NSEC_PER_SEC  1000000000u
+#define NSEC_PER_MSEC 1000000u
+#define NSEC_PER_USEC 1000u
+
+// Raw timestamp counter: a single rdtsc, cheap enough for every syscall,
+// IRQ and context switch. Convert intervals with ktime_cycles_to_ns().
+static inline uint64_t ktime_cycles(void) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// Calibrated TSC->ns conversion (0 before calibration)
+uint64_t ktime_cycles_to_ns(uint64_t cycles);
+uint32_t ktime_cpu_khz(void);
+
+// Choose the clocksource; call after paging and acpi_init()
+void ktime_init(void);
+
+// Nanoseconds since ktime_init()
+uint64_t ktime_get_ns(void);
+
+// Name of the active clocksource and its resolution in ns
+const char* ktime_source_name(void);
+uint32_t ktime_resolution_ns(void);
+
+// Called from the timer tick to keep narrow counters from wrapping unseen
+void ktime_tick(void);
+
+// v * mult >> shift for a 64-bit v, without losing the high half
+static inline uint64_t ktime_mul_shift(uint64_t v, uint32_t mult, uint32_t shift) {
+    uint32_t hi = (uint32_t)(v >> 32), lo = (uint32_t)v;
+    return (((uint64_t)hi * mult) << (32 - shift)) + (((uint64_t)lo * mult) >> shift);
+}
+
+// 64-by-32 division without libgcc: quotient returned, remainder in *rem
+static inline uint64_t ktime_div_u64(uint64_t n, uint32_t d, uint32_t* rem) {
+    uint32_t hi = (uint32_t)(n >> 32), lo = (uint32_t)n;
+    uint32_t q_hi = hi / d, r = hi % d, q_lo;
+    // r < d, so the low quotient fits in 32 bits
+    __asm__("divl %4" : "=a"(q_lo), "=d"(r) : "a"(lo), "d"(r), "rm"(d));
+    if (rem) *rem = r;
+    return ((uint64_t)q_hi << 32) | q_lo;
+}
+
+#endif // _KERNEL_KTIME_H
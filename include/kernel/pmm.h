@@ -3,12 +3,13 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "include/memory/pmm.h"
 
 // Sayfa boyutu (4KB)
 #define PMM_PAGE_SIZE 0x1000
 
-// Fiziksel bellek yöneticisini başlat
-void pmm_init(void);
+// Eski işaretçi tabanlı arayüz; hepsi memory/pmm.c içindeki bölgeli
+// ayırıcıya yönlendirilir. Başlatma için pmm_init() (memory/pmm.h) kullanılır.
 
 // Fiziksel bellek ayır
 void* pmm_alloc(void);
@@ -30,6 +30,9 @@ typedef struct process {
 // İşlem yönetimini başlat
 void process_init(void);
 
+// Verilen adres alanıyla yeni süreç kaydı oluştur (kopyalama yok)
+process_t* process_alloc(page_directory_t* dir);
+
 // Yeni bir işlem oluştur (fork benzeri)
 process_t* process_create(void);
 
@@ -39,6 +42,9 @@ int process_exec(process_t* proc, const char* path);
 // Mevcut işlemi sonlandır
 void process_exit(int exit_code);
 
+// Hazır süreci kendi çekirdek iş parçacığında zamanlayıcıya ver
+int process_start(process_t* proc);
+
 // İşlemleri zamanlayıcı
 void process_schedule(void);
 
@@ -0,0 +1,25 @@
+#ifndef _KERNEL_SCHEDSTAT_H
+#define _KERNEL_SCHEDSTAT_H
+
+#include <stdint.h>
+
+// Scheduler statistics shared between kernel and userspace (SYS_SCHED_STAT)
+
+// Wakeup-to-run latency histogram: bucket i counts wakeups that waited
+// [2^i, 2^(i+1)) ns on a ready queue before running; the last bucket
+// also takes everything longer
+#define SCHED_LAT_BUCKETS 32
+
+typedef struct {
+    uint32_t tid;
+    uint32_t state;          // thread_state_t
+    int32_t cpu;             // CPU it last ran on, -1 if never
+    int32_t priority;
+    uint64_t runtime_ns;     // Time on a CPU, including the current slice
+    uint64_t wait_ns;        // Time runnable but waiting on a ready queue
+    uint32_t switches;       // Times it was switched in
+    uint32_t voluntary;      // Switches out because it blocked or exited
+    uint32_t involuntary;    // Switches out while still runnable (preempted, yielded)
+} sched_stat_t;
+
+#endif // _KERNEL_SCHEDSTAT_H
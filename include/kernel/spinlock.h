@@ -0,0 +1,124 @@
+#ifndef _KERNEL_SPINLOCK_H
+#define _KERNEL_SPINLOCK_H
+
+#include <stdint.h>
+#include <kernel/ktime.h>
+
+// Busy-wait locks for data shared between CPUs and interrupt handlers.
+//
+// spinlock_t is a test-and-test-and-set lock: cheapest when uncontended and
+// the only one with a trylock. ticketlock_t hands the lock out in arrival
+// order, so no CPU starves on a hot lock. The _irqsave variants disable
+// interrupts on the local CPU first; use them for any lock an interrupt
+// handler may also take, or the handler can spin on its own CPU forever.
+//
+// Every lock counts acquisitions, contended acquisitions and the cycles
+// spent spinning. Locks register themselves on first use; lock_dump()
+// prints the table.
+
+typedef struct lock_stats {
+    const char* name;
+    uint32_t kind;                  // LOCK_KIND_*
+    uint32_t acquisitions;
+    uint32_t contended;             // Acquisitions that had to spin
+    uint64_t spin_cycles;
+    volatile uint32_t registered;
+    struct lock_stats* next;
+} lock_stats_t;
+
+#define LOCK_KIND_SPIN   0
+#define LOCK_KIND_TICKET 1
+
+typedef struct {
+    volatile uint32_t locked;
+    lock_stats_t stats;
+} spinlock_t;
+
+typedef struct {
+    volatile uint16_t next;         // Next ticket to hand out
+    volatile uint16_t owner;        // Ticket now being served
+    lock_stats_t stats;
+} ticketlock_t;
+
+#define SPINLOCK_INIT(n)   { 0, { (n), LOCK_KIND_SPIN, 0, 0, 0, 0, 0 } }
+#define TICKETLOCK_INIT(n) { 0, 0, { (n), LOCK_KIND_TICKET, 0, 0, 0, 0, 0 } }
+
+void spin_init(spinlock_t* lock, const char* name);
+void ticket_init(ticketlock_t* lock, const char* name);
+
+// Out-of-line parts: registration and the contended paths
+void lock_register(lock_stats_t* stats);
+void spin_lock_slow(spinlock_t* lock);
+void ticket_lock_slow(ticketlock_t* lock, uint16_t ticket);
+
+// Print every registered lock with its contention counters
+void lock_dump(void);
+
+static inline uint32_t irq_save(void) {
+    uint32_t flags;
+    __asm__ __volatile__("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & 0x200) __asm__ __volatile__("sti" ::: "memory");
+}
+
+static inline void lock_acquired(lock_stats_t* stats) {
+    if (!stats->registered) lock_register(stats);
+    stats->acquisitions++;
+}
+
+// ---- spinlock_t ----
+
+static inline int spin_trylock(spinlock_t* lock) {
+    if (__sync_lock_test_and_set(&lock->locked, 1)) return 0;
+    lock_acquired(&lock->stats);
+    return 1;
+}
+
+static inline void spin_lock(spinlock_t* lock) {
+    if (__sync_lock_test_and_set(&lock->locked, 1)) spin_lock_slow(lock);
+    lock_acquired(&lock->stats);
+}
+
+static inline void spin_unlock(spinlock_t* lock) {
+    __sync_lock_release(&lock->locked);
+}
+
+static inline uint32_t spin_lock_irqsave(spinlock_t* lock) {
+    uint32_t flags = irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags) {
+    spin_unlock(lock);
+    irq_restore(flags);
+}
+
+// ---- ticketlock_t ----
+
+static inline void ticket_lock(ticketlock_t* lock) {
+    uint16_t ticket = __sync_fetch_and_add(&lock->next, 1);
+    if (lock->owner != ticket) ticket_lock_slow(lock, ticket);
+    lock_acquired(&lock->stats);
+}
+
+static inline void ticket_unlock(ticketlock_t* lock) {
+    // Only the holder writes owner: a release store is enough
+    __atomic_store_n(&lock->owner, (uint16_t)(lock->owner + 1), __ATOMIC_RELEASE);
+}
+
+static inline uint32_t ticket_lock_irqsave(ticketlock_t* lock) {
+    uint32_t flags = irq_save();
+    ticket_lock(lock);
+    return flags;
+}
+
+static inline void ticket_unlock_irqrestore(ticketlock_t* lock, uint32_t flags) {
+    ticket_unlock(lock);
+    irq_restore(flags);
+}
+
+#endif // _KERNEL_SPINLOCK_H
@@ -125,6 +125,7 @@ typedef enum {
     SYS_FB_GETINFO = 240,
     SYS_FB_FILL    = 241,
     SYS_FB_RECT    = 242,
+    SYS_SCHED_STAT = 243,  // İş parçacığı zamanlama istatistikleri
     SYS_COUNT // Toplam syscall sayısı
 } syscall_num_t;
 
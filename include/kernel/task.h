@@ -14,6 +14,14 @@ struct user_context {
     uint32_t es;
     uint32_t fs;
     uint32_t gs;
+    // Genel amaçlı yazmaçlar (fork'ta çocuk syscall dönüşünden devam eder)
+    uint32_t eax;
+    uint32_t ebx;
+    uint32_t ecx;
+    uint32_t edx;
+    uint32_t esi;
+    uint32_t edi;
+    uint32_t ebp;
 } __attribute__((packed));
 
 // İşlem kontrol bloğu (PCB) yapısı
@@ -30,4 +30,35 @@ void sleep(uint32_t ms);
 // Set a callback function to be called on each timer tick
 void timer_set_callback(void (*callback)(void));
 
+// A device able to raise the kernel tick. Counts are device units;
+// counts_per_tick of them make one tick at TIMER_FREQ.
+typedef struct timer_device {
+    const char* name;
+    uint32_t counts_per_tick;
+    uint32_t max_counts;                 // Longest one-shot the device can arm
+    void (*periodic)(void);              // Tick at TIMER_FREQ
+    void (*oneshot)(uint32_t counts);    // Fire once after 'counts'
+    uint32_t (*remaining)(void);         // Counts left on the pending one-shot
+} timer_device_t;
+
+// Move the tick to another device (NULL returns it to the PIT)
+void timer_set_device(const timer_device_t* dev);
+const char* timer_device_name(void);
+
+// Tickless idle statistics
+typedef struct {
+    int tickless;            // One-shot idle enabled
+    uint32_t avoided_ticks;  // Ticks accounted without taking an interrupt
+    uint32_t idle_entries;   // One-shot idle periods started
+    uint32_t idle_early;     // Idle periods cut short by another interrupt
+} timer_idle_stats_t;
+
+// Halt until the given tick (or any interrupt), skipping periodic ticks
+void timer_idle_until(uint32_t deadline);
+
+// Enable/disable one-shot idle (enabled by default)
+void timer_set_tickless(int on);
+
+void timer_get_idle_stats(timer_idle_stats_t* out);
+
 #endif // _KERNEL_TIMER_H
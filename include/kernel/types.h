@@ -9,8 +9,9 @@ typedef int32_t pid_t;
 typedef int32_t tid_t;
 
 // Sayfalama ile ilgili tipler
-typedef uint32_t* page_directory_t;
-typedef uint32_t* page_table_t;
+// Dizin/tablo girdisi; page_directory_t* 1024 girdilik dizini gösterir
+typedef uint32_t page_directory_t;
+typedef uint32_t page_table_t;
 
 // Hata kodları
 typedef int32_t status_t;
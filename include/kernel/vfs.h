@@ -182,6 +182,7 @@ int vfs_close(int fd);
 ssize_t vfs_read(int fd, void* buf, size_t count);
 ssize_t vfs_write(int fd, const void* buf, size_t count);
 off_t vfs_lseek(int fd, off_t offset, int whence);
+ssize_t vfs_node_read(vfs_node_t* node, uint32_t offset, void* buf, size_t count);
 int vfs_size(int fd);
 
 // Read helper for files
@@ -0,0 +1,61 @@
+#ifndef _KERNEL_VM_H
+#define _KERNEL_VM_H
+
+#include <stdint.h>
+#include "vfs.h"
+
+// Bölge bayrakları
+#define VM_WRITE 0x1   // Kullanıcı yazabilir
+
+// Bir dosyanın bölgeler arasında paylaşılan kopyası (lookup sonucu düğüm)
+typedef struct vm_backing {
+    vfs_node_t node;
+    uint32_t refs;
+} vm_backing_t;
+
+// Tembel (talep üzerine doldurulan) kullanıcı bölgesi. Sayfalar ilk
+// erişimde sayfa hatası işleyicisinde ayrılır: [file_start, file_end)
+// aralığı dosyadan okunur, geri kalanı (ör. .bss) sıfırla doldurulur.
+typedef struct vm_region {
+    uint32_t* dir;          // Sahip adres alanı
+    uint32_t start;         // Sayfa hizalı başlangıç
+    uint32_t end;           // Sayfa hizalı bitiş (dahil değil)
+    uint32_t file_start;    // Dosya verisinin başladığı sanal adres
+    uint32_t file_end;      // Dosya verisinin bittiği sanal adres
+    uint32_t file_off;      // file_start'a karşılık gelen dosya ofseti
+    uint32_t flags;         // VM_*
+    vm_backing_t* backing;  // NULL = anonim (sıfır dolu)
+    struct vm_region* next;
+} vm_region_t;
+
+typedef struct {
+    uint32_t regions;       // Canlı bölge sayısı
+    uint32_t faults;        // Çözülen talep hataları
+    uint32_t file_pages;    // Dosyadan doldurulan sayfalar
+    uint32_t zero_pages;    // Yalnızca sıfırla doldurulan sayfalar
+    uint32_t cache_hits;    // Sayfa önbelleğinden kopyasız eşlenen sayfalar
+    uint32_t cached_pages;  // Önbellekteki salt okunur dosya sayfaları
+} vm_stats_t;
+
+// Dosyayı bölgelere kaynak olarak aç / bırak
+vm_backing_t* vm_backing_open(const char* path);
+void vm_backing_put(vm_backing_t* backing);
+
+// 'dir' adres alanına tembel bölge ekle (backing referansı alınır)
+int vm_map_region(uint32_t* dir, uint32_t start, uint32_t end, uint32_t flags,
+                  vm_backing_t* backing, uint32_t file_start, uint32_t file_end,
+                  uint32_t file_off);
+
+// Adres alanının bölgelerini kopyala (fork) / tümünü kaldır (exit, exec)
+int vm_clone_regions(uint32_t* src, uint32_t* dst);
+void vm_unmap_all(uint32_t* dir);
+
+// Sayfa hatası: adres bir bölgedeyse sayfayı doldurup 0 döndürür
+int vm_handle_fault(uint32_t addr, uint32_t error_code);
+
+// Yazılan dosyanın önbellekteki sayfalarını at
+void vm_pcache_invalidate(const vfs_node_t* node);
+
+void vm_get_stats(vm_stats_t* out);
+
+#endif // _KERNEL_VM_H
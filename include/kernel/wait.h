@@ -0,0 +1,46 @@
+#ifndef _KERNEL_WAIT_H
+#define _KERNEL_WAIT_H
+
+#include <stddef.h>
+#include <kernel/spinlock.h>
+
+struct thread;
+
+// Threads blocked until some event happens (input arrived, a buffer
+// drained). A sleeper queues itself, marks itself THREAD_BLOCKED and
+// leaves the CPU; wake_up_one()/wake_up_all() make it runnable again and
+// may be called from interrupt handlers.
+//
+// Always sleep through wait_event(): the condition is re-checked after
+// queueing, so a wakeup that races with the check is never lost.
+typedef struct wait_queue {
+    spinlock_t lock;
+    struct thread* head;
+    struct thread* tail;
+} wait_queue_t;
+
+#define WAIT_QUEUE_INIT(n) { SPINLOCK_INIT(n), NULL, NULL }
+
+void wait_queue_init(wait_queue_t* wq, const char* name);
+
+// Building blocks of wait_event()
+void wait_prepare(wait_queue_t* wq);
+void wait_schedule(void);
+void wait_finish(wait_queue_t* wq);
+
+// Wake the longest waiter / every waiter; return how many were woken
+int wake_up_one(wait_queue_t* wq);
+int wake_up_all(wait_queue_t* wq);
+
+// Sleep on 'wq' until 'cond' holds
+#define wait_event(wq, cond)            \
+    do {                                \
+        for (;;) {                      \
+            wait_prepare(wq);           \
+            if (cond) break;            \
+            wait_schedule();            \
+        }                               \
+        wait_finish(wq);                \
+    } while (0)
+
+#endif // _KERNEL_WAIT_H
@@ -1,9 +1,54 @@
 #pragma once
 #include <stdint.h>
 
-void pmm_init(uint32_t mem_upper_kb, uint32_t kernel_start, uint32_t kernel_end, struct multiboot_info* mbi);
+struct multiboot_mmap_entry;
+
+// Physical memory zones. DMA is what legacy ISA DMA can reach; HIGH is the
+// part a 3GB/1GB split kernel cannot keep permanently mapped.
+#define PMM_DMA_LIMIT    0x01000000u  // 16MB
+#define PMM_NORMAL_LIMIT 0x38000000u  // 896MB
+
+enum {
+    PMM_ZONE_DMA = 0,
+    PMM_ZONE_NORMAL,
+    PMM_ZONE_HIGH,
+    PMM_ZONE_COUNT
+};
+
+typedef struct {
+    const char* name;
+    uint32_t start_frame;        // first frame index of the zone
+    uint32_t end_frame;          // one past the last frame index
+    uint32_t present_frames;     // RAM frames reported by the firmware
+    uint32_t free_frames;        // kept up to date on every alloc/free
+    uint32_t hint;               // next-fit cursor (bitmap word index)
+} pmm_zone_t;
+
+// Largest naturally aligned block order tracked for contiguous allocations
+// (2^10 frames = 4MB, one large page)
+#define PMM_MAX_ORDER 10
+
+typedef struct {
+    uint32_t free_frames;
+    uint32_t free_runs;          // maximal runs of free frames
+    uint32_t largest_run;        // frames in the longest run
+    uint32_t free_blocks[PMM_MAX_ORDER + 1]; // aligned 2^k blocks available
+} pmm_frag_stats_t;
+
+void pmm_init(uint32_t mem_upper_kb, uint32_t kernel_start, uint32_t kernel_end,
+              const struct multiboot_mmap_entry* mmap, uint32_t mmap_count);
 void pmm_init_basic(uint32_t mem_upper_kb, uint32_t kernel_start, uint32_t kernel_end);
 void pmm_init_default(uint32_t mem_upper_kb);
 void pmm_mark_used_region(uint32_t base, uint32_t size);
 uint32_t pmm_alloc_frame(void);
-void pmm_free_frame(uint32_t frame_addr);
\ No newline at end of file
+uint32_t pmm_alloc_frame_zone(int zone);
+void pmm_free_frame(uint32_t frame_addr);
+uint32_t pmm_frame_ref(uint32_t frame_addr);
+uint32_t pmm_frame_refcount(uint32_t frame_addr);
+uint32_t pmm_total_frame_count(void);
+uint32_t pmm_used_frame_count(void);
+uint32_t pmm_free_frame_count(void);
+const pmm_zone_t* pmm_get_zone(int zone);
+uint32_t pmm_alloc_frames(uint32_t count, uint32_t alignment);
+void pmm_free_frames(uint32_t base, uint32_t count);
+void pmm_get_frag_stats(pmm_frag_stats_t* out);
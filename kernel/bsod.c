@@ -1,6 +1,7 @@
 
 #include "../include/kernel/console.h"
 #include "../include/arch/x86/isr.h"
+#include "../include/drivers/serial.h"
 #include <stdarg.h>
 #include <stdint.h>
 #include <stddef.h>
@@ -45,6 +46,7 @@ static const char* s_exc_names[] = {
 };
 
 static void bsod_header(const char* title){
+    console_panic();
     console_set_color(CONSOLE_COLOR_WHITE, CONSOLE_COLOR_BLUE);
     console_clear();
     console_set_cursor(0, 0);
@@ -72,6 +74,12 @@ static void bsod_regs(const struct isr_context* ctx){
 
 // Genel amaçlı mavi ekran: başlık + mesaj + durdurma
 void kernel_bsod(const char* msg, ...) {
+    // Seri kuyruğu boşalt, bundan sonra kesmesiz (senkron) yaz
+    serial_panic();
+    serial_write("\r\n*** KERNEL PANIC: ");
+    if (msg) serial_write(msg);
+    serial_write("\r\n");
+
     bsod_header("Kernel Hatasi");
 
     // Basit mesaj yazımı (formatlama olmadan)
@@ -87,6 +95,7 @@ void kernel_bsod(const char* msg, ...) {
 // Istisna icin detayli mavi ekran
 void kernel_bsod_exception(uint32_t vector, uint32_t error_code, const struct isr_context* ctx, uint32_t cr2) {
     const char* name = (vector < (sizeof(s_exc_names)/sizeof(s_exc_names[0]))) ? s_exc_names[vector] : "Bilinmeyen Istisna";
+    serial_panic();
     bsod_header("CPU Istisnasi");
 
     console_puts("Istisna: "); console_puts(name); console_puts(" (vector="); console_put_dec(vector); console_puts(")\n");
@@ -1,6 +1,12 @@
 #include "../include/kernel/console.h"
+#include "../include/kernel/wait.h"
+#include "../include/kernel/spinlock.h"
+#include "../include/drivers/keyboard.h"
+#include "../include/drivers/serial.h"
+#include "../include/arch/x86/io.h"
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 
 // Use VGA text mode buffer address directly for CLI
 #define VGA_TEXT_ADDR 0xB8000
@@ -9,96 +15,254 @@
 #define CONSOLE_WIDTH 80
 #define CONSOLE_HEIGHT 25
 
+// Lines kept in RAM, the visible screen included; the rest is scrollback
+#define CONSOLE_HISTORY 256
+
 // Current console state
-uint16_t* vga_buffer;
+uint16_t* vga_buffer = (uint16_t*)VGA_TEXT_ADDR;
 uint32_t console_x = 0;
 uint32_t console_y = 0;
 uint8_t console_attr = CONSOLE_DEFAULT_ATTR;
 
+// The text lives in a ring of lines; VGA memory is only a window onto it.
+// Scrolling moves console_top by one line and copies the window out again,
+// so nothing is shifted cell by cell.
+static uint16_t console_ring[CONSOLE_HISTORY][CONSOLE_WIDTH];
+static uint32_t console_top = 0;                // Ring line at screen row 0
+static uint32_t console_lines = CONSOLE_HEIGHT; // Ring lines holding output
+static uint32_t console_view = 0;               // Lines scrolled back, 0 = live
+
+// Every entry point that changes the console holds console_lock with
+// interrupts off: writers on different CPUs (and interrupt handlers
+// echoing input) would otherwise interleave inside a line. The panic
+// screen stops taking it, since the holder may be the CPU that crashed.
+static spinlock_t console_lock = SPINLOCK_INIT("console");
+static volatile int console_nolock = 0;
+
+static inline uint32_t console_lock_irqsave(void) {
+    if (console_nolock) return irq_save();
+    return spin_lock_irqsave(&console_lock);
+}
+
+static inline void console_unlock_irqrestore(uint32_t flags) {
+    if (console_nolock) irq_restore(flags);
+    else spin_unlock_irqrestore(&console_lock, flags);
+}
+
+static inline uint16_t console_blank(void) {
+    return (uint16_t)(console_attr << 8) | ' ';
+}
+
+// Ring line shown at screen row 'row' of the live view
+static inline uint16_t* console_line(uint32_t row) {
+    return console_ring[(console_top + row) % CONSOLE_HISTORY];
+}
+
+static void console_fill_line(uint16_t* line) {
+    const uint16_t blank = console_blank();
+    for (size_t x = 0; x < CONSOLE_WIDTH; x++) line[x] = blank;
+}
+
+// Copy the viewed window to VGA memory. The ring's lines are contiguous,
+// so this is one bulk copy, split in two only when the window wraps
+// around the end of the ring.
+static void console_redraw(void) {
+    uint32_t first = (console_top + CONSOLE_HISTORY - console_view) % CONSOLE_HISTORY;
+    uint32_t rows = CONSOLE_HISTORY - first;
+    if (rows > CONSOLE_HEIGHT) rows = CONSOLE_HEIGHT;
+    memcpy(vga_buffer, console_ring[first], rows * CONSOLE_WIDTH * sizeof(uint16_t));
+    if (rows < CONSOLE_HEIGHT) {
+        memcpy(vga_buffer + rows * CONSOLE_WIDTH, console_ring[0],
+               (CONSOLE_HEIGHT - rows) * CONSOLE_WIDTH * sizeof(uint16_t));
+    }
+}
+
+// Move the blinking hardware cursor to the console position (hidden
+// below the screen while scrolled back)
+static void console_update_cursor(void) {
+    uint16_t pos = console_view ? CONSOLE_WIDTH * CONSOLE_HEIGHT
+                                : (uint16_t)(console_y * CONSOLE_WIDTH + console_x);
+    outb(0x3D4, 0x0F);
+    outb(0x3D5, (uint8_t)(pos & 0xFF));
+    outb(0x3D4, 0x0E);
+    outb(0x3D5, (uint8_t)(pos >> 8));
+}
+
+// New output always shows up in the live view
+static inline void console_follow_output(void) {
+    if (console_view) {
+        console_view = 0;
+        console_redraw();
+    }
+}
+
+static inline void console_set_cell(uint32_t x, uint32_t y, uint16_t cell) {
+    console_line(y)[x] = cell;
+    vga_buffer[y * CONSOLE_WIDTH + x] = cell;
+}
+
 // Initialize the console
 void console_init(void) {
     // Use VGA text buffer directly
     vga_buffer = (uint16_t*)VGA_TEXT_ADDR;
     console_clear();
+    console_update_cursor();
 }
 
+// Panic path: write without the lock from here on
+void console_panic(void) {
+    console_nolock = 1;
+}
 
-
-// Clear the console
+// Clear the console (scrollback included)
 void console_clear(void) {
-    for (size_t y = 0; y < CONSOLE_HEIGHT; y++) {
-        for (size_t x = 0; x < CONSOLE_WIDTH; x++) {
-            const size_t index = y * CONSOLE_WIDTH + x;
-            vga_buffer[index] = (console_attr << 8) | ' ';
-        }
+    uint32_t flags = console_lock_irqsave();
+    console_top = 0;
+    console_lines = CONSOLE_HEIGHT;
+    console_view = 0;
+    for (uint32_t y = 0; y < CONSOLE_HEIGHT; y++) {
+        console_fill_line(console_line(y));
     }
+    console_redraw();
     console_x = 0;
     console_y = 0;
+    console_unlock_irqrestore(flags);
 }
 
-// Scroll the console up by one line
-void console_scroll(void) {
-    // Move all lines up by one
-    for (size_t y = 1; y < CONSOLE_HEIGHT; y++) {
-        for (size_t x = 0; x < CONSOLE_WIDTH; x++) {
-            const size_t from_index = y * CONSOLE_WIDTH + x;
-            const size_t to_index = (y - 1) * CONSOLE_WIDTH + x;
-            vga_buffer[to_index] = vga_buffer[from_index];
-        }
-    }
-    
-    // Clear the last line
-    const size_t last_line_start = (CONSOLE_HEIGHT - 1) * CONSOLE_WIDTH;
-    for (size_t x = 0; x < CONSOLE_WIDTH; x++) {
-        vga_buffer[last_line_start + x] = (console_attr << 8) | ' ';
-    }
-    
+// Scroll the console up by one line. The *_locked helpers below expect
+// console_lock to be held; the public wrappers take it.
+static void console_scroll_locked(void) {
+    console_top = (console_top + 1) % CONSOLE_HISTORY;
+    if (console_lines < CONSOLE_HISTORY) console_lines++;
+    console_fill_line(console_line(CONSOLE_HEIGHT - 1));
+    console_redraw();
+
     if (console_y > 0) {
         console_y--;
     }
 }
 
+void console_scroll(void) {
+    uint32_t flags = console_lock_irqsave();
+    console_scroll_locked();
+    console_unlock_irqrestore(flags);
+}
+
+// Look 'lines' further back into the scrollback (negative: towards the
+// live view). Clamped to the history that holds output.
+void console_scrollback(int lines) {
+    uint32_t flags = console_lock_irqsave();
+    int max = (int)(console_lines - CONSOLE_HEIGHT);
+    int view = (int)console_view + lines;
+    if (view < 0) view = 0;
+    if (view > max) view = max;
+    if ((uint32_t)view != console_view) {
+        console_view = (uint32_t)view;
+        console_redraw();
+        console_update_cursor();
+    }
+    console_unlock_irqrestore(flags);
+}
+
+// Advance to the start of the next line, scrolling at the bottom
+static void console_newline(void) {
+    console_x = 0;
+    if (++console_y >= CONSOLE_HEIGHT) {
+        console_scroll_locked();
+    }
+}
+
 // Put a character at the current cursor position
-void console_putc(char c) {
+static void console_putc_locked(char c) {
+    console_follow_output();
     if (c == '\n') {
-        console_x = 0;
-        console_y++;
+        console_newline();
+        return;
     } else if (c == '\r') {
         console_x = 0;
     } else if (c == '\t') {
         console_x = (console_x + 8) & ~7;
-    } else if (c >= ' ') {
-        const size_t index = console_y * CONSOLE_WIDTH + console_x;
-        vga_buffer[index] = (console_attr << 8) | c;
+    } else if (c == '\b') {
+        // Step back (onto the previous line if needed) and blank the cell
+        if (console_x > 0) {
+            console_x--;
+        } else if (console_y > 0) {
+            console_y--;
+            console_x = CONSOLE_WIDTH - 1;
+        } else {
+            return;
+        }
+        console_set_cell(console_x, console_y, console_blank());
+        return;
+    } else if ((uint8_t)c >= ' ') {
+        console_set_cell(console_x, console_y, (uint16_t)(console_attr << 8) | (uint8_t)c);
         console_x++;
     }
-    
+
     // Handle line wrapping and scrolling
     if (console_x >= CONSOLE_WIDTH) {
-        console_x = 0;
-        console_y++;
+        console_newline();
     }
-    
-    if (console_y >= CONSOLE_HEIGHT) {
-        console_scroll();
+}
+
+void console_putc(char c) {
+    uint32_t flags = console_lock_irqsave();
+    console_putc_locked(c);
+    console_unlock_irqrestore(flags);
+}
+
+// Write 'len' bytes (NULs included) in one go. Runs of printable
+// characters are stored into their ring line and copied to VGA memory
+// once per line; only control characters take the console_putc() path.
+static void console_write_locked(const char* str, size_t len) {
+    console_follow_output();
+    const uint16_t attr = (uint16_t)console_attr << 8;
+    size_t i = 0;
+    while (i < len) {
+        // The run is bounded by this x, so use the same x to place it
+        uint32_t x = console_x, y = console_y;
+        size_t room = CONSOLE_WIDTH - x;
+        size_t run = 0;
+        while (run < room && i + run < len && (uint8_t)str[i + run] >= ' ') run++;
+        if (!run) {
+            console_putc_locked(str[i++]);
+            continue;
+        }
+
+        uint16_t* line = console_line(y);
+        for (size_t k = 0; k < run; k++) line[x + k] = attr | (uint8_t)str[i + k];
+        memcpy(vga_buffer + y * CONSOLE_WIDTH + x, line + x, run * sizeof(uint16_t));
+        i += run;
+        console_x = x + run;
+        if (console_x >= CONSOLE_WIDTH) {
+            console_newline();
+        }
     }
 }
 
+// The hardware cursor is moved once at the end
+void console_write(const char* str, size_t len) {
+    uint32_t flags = console_lock_irqsave();
+    console_write_locked(str, len);
+    console_update_cursor();
+    console_unlock_irqrestore(flags);
+}
+
 // Output a null-terminated string
 void console_puts(const char* str) {
-    while (*str) {
-        console_putc(*str++);
-    }
+    console_write(str, strlen(str));
 }
 
 // Set the console text attribute
 void console_set_attr(uint8_t attr) {
+    uint32_t flags = console_lock_irqsave();
     console_attr = attr;
+    console_unlock_irqrestore(flags);
 }
 
 // Set the console foreground and background colors
 void console_set_color(uint8_t fg, uint8_t bg) {
-    console_attr = (bg << 4) | (fg & 0x0F);
+    console_set_attr((uint8_t)((bg << 4) | (fg & 0x0F)));
 }
 
 // Get the current cursor position
@@ -109,24 +273,118 @@ void console_get_cursor(uint32_t* x, uint32_t* y) {
 
 // Set the cursor position
 void console_set_cursor(uint32_t x, uint32_t y) {
+    uint32_t flags = console_lock_irqsave();
     if (x < CONSOLE_WIDTH) console_x = x;
     if (y < CONSOLE_HEIGHT) console_y = y;
+    console_update_cursor();
+    console_unlock_irqrestore(flags);
 }
 
 // Print a 32-bit value in hexadecimal (8 digits, uppercase)
 void console_put_hex(uint32_t n) {
-    for (int i = 7; i >= 0; --i) {
-        uint8_t nibble = (n >> (i * 4)) & 0xF;
-        char ch = (nibble < 10) ? ('0' + nibble) : ('A' + (nibble - 10));
-        console_putc(ch);
+    char buf[8];
+    for (int i = 0; i < 8; ++i) {
+        uint8_t nibble = (n >> ((7 - i) * 4)) & 0xF;
+        buf[i] = (nibble < 10) ? ('0' + nibble) : ('A' + (nibble - 10));
     }
+    console_write(buf, sizeof(buf));
 }
 
 // Print an unsigned integer in decimal
 void console_put_dec(uint32_t n) {
-    char buf[11];
+    char buf[10];
+    int i = sizeof(buf);
+    do { buf[--i] = '0' + (n % 10); n /= 10; } while (n);
+    console_write(buf + i, sizeof(buf) - i);
+}
+
+// Simple printf implementation
+static void itoa_unsigned(unsigned int val, unsigned int base, char* buf_out) {
+    static const char digits[] = "0123456789abcdef";
+    char tmp[32];
     int i = 0;
-    if (n == 0) { console_putc('0'); return; }
-    while (n && i < (int)sizeof(buf)) { buf[i++] = '0' + (n % 10); n /= 10; }
-    while (i > 0) console_putc(buf[--i]);
+    if (val == 0) { buf_out[0] = '0'; buf_out[1] = '\0'; return; }
+    while (val && i < (int)sizeof(tmp)) { tmp[i++] = digits[val % base]; val /= base; }
+    int j = 0; while (i > 0) buf_out[j++] = tmp[--i]; buf_out[j] = '\0';
+}
+
+static void itoa_signed(int val, char* buf_out) {
+    if (val < 0) { *buf_out++ = '-'; itoa_unsigned((unsigned int)(-val), 10, buf_out); }
+    else { itoa_unsigned((unsigned int)val, 10, buf_out); }
+}
+
+// Literal text between conversions goes out as one run. The caller holds
+// the console lock, so a message is never split by another CPU's output.
+static void kvprintf(const char* fmt, va_list ap) {
+    const char* p = fmt;
+    while (*p) {
+        const char* lit = p;
+        while (*p && *p != '%') p++;
+        if (p > lit) console_write_locked(lit, (size_t)(p - lit));
+        if (!*p) break;
+        ++p;
+        if (!*p) break;
+        char numbuf[40];
+        switch (*p) {
+            case 's': {
+                const char* s = va_arg(ap, const char*);
+                s = s ? s : "(null)";
+                console_write_locked(s, strlen(s));
+            } break;
+            case 'd': {
+                itoa_signed(va_arg(ap, int), numbuf);
+                console_write_locked(numbuf, strlen(numbuf));
+            } break;
+            case 'x': {
+                itoa_unsigned(va_arg(ap, unsigned int), 16, numbuf);
+                console_write_locked(numbuf, strlen(numbuf));
+            } break;
+            case 'c': {
+                char ch = (char)va_arg(ap, int);
+                console_write_locked(&ch, 1);
+            } break;
+            case '%': console_write_locked("%", 1); break;
+            default: console_write_locked(p - 1, 2); break;
+        }
+        ++p;
+    }
+}
+
+void kprintf(const char* fmt, ...) {
+    va_list ap; va_start(ap, fmt);
+    uint32_t flags = console_lock_irqsave();
+    kvprintf(fmt, ap);
+    console_update_cursor();
+    console_unlock_irqrestore(flags);
+    va_end(ap);
+}
+
+// Readers blocked in console_getchar()
+static wait_queue_t console_input_wait = WAIT_QUEUE_INIT("console-in");
+
+// Called from the keyboard and COM1 interrupt handlers
+void console_input_notify(void) {
+    wake_up_all(&console_input_wait);
+}
+
+// Next input byte from the keyboard or COM1, -1 if neither has one.
+// PgUp/PgDn are handled here: they page through the scrollback.
+int console_getchar_nonblock(void) {
+    int k;
+    while ((k = keyboard_getkey_nonblock()) >= 0) {
+        if (k < KBD_KEY_BASE) return k;
+        if (k == KBD_PGUP) console_scrollback(CONSOLE_HEIGHT / 2);
+        else if (k == KBD_PGDN) console_scrollback(-(CONSOLE_HEIGHT / 2));
+    }
+    int c = serial_getchar_nonblock();
+    // Serial terminals send CR for Enter
+    if (c == '\r') c = '\n';
+    return c;
+}
+
+// Block until an input byte arrives; the caller uses no CPU meanwhile
+int console_getchar(void) {
+    int c;
+    wait_event(&console_input_wait, (c = console_getchar_nonblock()) >= 0);
+    return c;
 }
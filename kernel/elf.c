@@ -5,15 +5,16 @@
 #include <kernel/vfs.h>
 #include <kernel/process.h>
 #include <kernel/types.h>
+#include <kernel/vm.h>
+#include <kernel/thread.h>
+#include <kernel/sched.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 #include "drivers/serial.h" // Ensure serial_write functions are declared
 
-// Forward declarations for missing functions
-extern void* kmalloc_a(unsigned long size);
-extern void map_page(page_directory_t* dir, void* virt, void* phys, int flags);
+extern page_directory_t* kernel_directory;
 
 // ELF dosyasının geçerli olup olmadığını kontrol et
 static int elf_validate(const Elf32_Ehdr* hdr) {
@@ -48,23 +49,6 @@ static int elf_validate(const Elf32_Ehdr* hdr) {
     return 1; // Geçerli ELF dosyası
 }
 
-// Bellek sayfalarını eşle
-static void map_pages(page_directory_t* page_dir, void* virt_addr, size_t size, int user) {
-    uint32_t virt = (uint32_t)virt_addr;
-    uint32_t end = virt + size;
-    
-    // Sayfa hizalamasını yap
-    virt = virt & ~0xFFF;
-    
-    // Her sayfayı eşle
-    for (; virt < end; virt += 0x1000) {
-        void* phys = kmalloc_a(0x1000);
-        if (phys) {
-            map_page(page_dir, (void*)virt, phys, user ? 1 : 0);
-        }
-    }
-}
-
 // ELF dosyasını yükle
 void* elf_load(const void* data, size_t size) {
     (void)data; // Suppress unused parameter warning
@@ -143,78 +127,115 @@ void* elf_load(const void* data, size_t size) {
     return elf_data; // Return the loaded ELF data
 }
 
-int elf_exec(const char* filename) {
-    // Load the ELF file into memory
-    struct stat st;
-    if (vfs_stat(filename, &st) < 0) {
-        serial_write("[elf_exec] Failed to stat file\n");
-        return -1;
-    }
-
-    if ((size_t)st.st_size < sizeof(Elf32_Ehdr)) {
-        serial_write("[elf_exec] File too small to be a valid ELF\n");
-        return -1;
-    }
-
+// ELF'i talep üzerine sayfalanan bölgeler olarak verilen adres alanına kaydet.
+// Yalnızca başlıklar okunur; segment sayfaları ilk erişimde sayfa hatası
+// işleyicisinde doldurulur (salt okunur metin sayfa önbelleğinden paylaşılır),
+// .bss ve yığın sayfaları sıfırla doldurulur.
+int elf_map(const char* filename, page_directory_t* dir, uint32_t* entry) {
     int fd = vfs_open(filename, 0);
     if (fd < 0) {
-        serial_write("[elf_exec] Failed to open file\n");
+        serial_write("[elf_map] Failed to open file\n");
         return -1;
     }
 
     Elf32_Ehdr eh;
     if (vfs_read(fd, &eh, sizeof(eh)) < (ssize_t)sizeof(eh)) {
-        serial_write("[elf_exec] Failed to read ELF header\n");
+        serial_write("[elf_map] Failed to read ELF header\n");
         vfs_close(fd);
         return -1;
     }
 
-    if (!elf_validate(&eh)) {
-        serial_write("[elf_exec] Invalid ELF file\n");
+    if (!elf_validate(&eh) || eh.e_phentsize != sizeof(Elf32_Phdr) ||
+        eh.e_phnum == 0 || eh.e_phnum > ELF_MAX_PHDRS) {
+        serial_write("[elf_map] Invalid ELF file\n");
         vfs_close(fd);
         return -1;
     }
 
-    // Allocate memory for the ELF file
-    void* elf_data = kmalloc(st.st_size);
-    if (!elf_data) {
-        serial_write("[elf_exec] Memory allocation failed\n");
+    Elf32_Phdr ph[ELF_MAX_PHDRS];
+    size_t ph_size = eh.e_phnum * sizeof(Elf32_Phdr);
+    if (vfs_lseek(fd, eh.e_phoff, SEEK_SET) < 0 ||
+        vfs_read(fd, ph, ph_size) < (ssize_t)ph_size) {
+        serial_write("[elf_map] Failed to read program headers\n");
         vfs_close(fd);
         return -1;
     }
+    vfs_close(fd);
 
-    if (vfs_read(fd, elf_data, st.st_size) < (ssize_t)st.st_size) {
-        serial_write("[elf_exec] Failed to read ELF file\n");
-        kfree(elf_data);
-        vfs_close(fd);
+    vm_backing_t* backing = vm_backing_open(filename);
+    if (!backing) {
+        serial_write("[elf_map] Failed to look up file\n");
         return -1;
     }
 
-    vfs_close(fd);
-
-    // Parse program headers and map segments
-    Elf32_Phdr* ph = (Elf32_Phdr*)((uint8_t*)elf_data + eh.e_phoff);
     for (int i = 0; i < eh.e_phnum; i++) {
-        if (ph[i].p_type != PT_LOAD) {
+        if (ph[i].p_type != PT_LOAD || ph[i].p_memsz == 0) {
             continue;
         }
+        uint32_t start = ph[i].p_vaddr;
+        uint32_t flags = (ph[i].p_flags & PF_W) ? VM_WRITE : 0;
+        if (vm_map_region(dir, start, start + ph[i].p_memsz, flags, backing,
+                          start, start + ph[i].p_filesz, ph[i].p_offset) < 0) {
+            serial_write("[elf_map] Bad segment\n");
+            vm_unmap_all(dir);
+            vm_backing_put(backing);
+            return -1;
+        }
+    }
+    vm_backing_put(backing); // artık bölgeler tutuyor
 
-        void* virt_addr = (void*)ph[i].p_vaddr;
-        size_t mem_size = ph[i].p_memsz;
-        process_t* cur = process_current();
-        page_directory_t* dir = cur ? cur->page_dir : NULL;
-        map_pages(dir, virt_addr, mem_size, 1);
+    if (vm_map_region(dir, ELF_USER_STACK_TOP - ELF_USER_STACK_SIZE, ELF_USER_STACK_TOP,
+                      VM_WRITE, NULL, 0, 0, 0) < 0) {
+        serial_write("[elf_map] Failed to map stack\n");
+        vm_unmap_all(dir);
+        return -1;
+    }
 
-        memcpy(virt_addr, (uint8_t*)elf_data + ph[i].p_offset, ph[i].p_filesz);
+    *entry = eh.e_entry;
+    return 0;
+}
+
+// ELF'i yeni bir adres alanına yükle ve kullanıcı moduna geç
+int elf_exec(const char* filename) {
+    page_directory_t* dir = paging_create_directory();
+    if (!dir) {
+        return -1;
     }
 
-    kfree(elf_data);
+    uint32_t entry;
+    if (elf_map(filename, dir, &entry) < 0) {
+        paging_destroy_directory(dir);
+        return -1;
+    }
+
+    process_t* cur = process_current();
+    thread_t* self = sched_current_thread();
+    if (self && (!cur || cur->page_dir == kernel_directory)) {
+        // Çekirdek iş parçacıkları kök süreci paylaşır: program kendi
+        // sürecini alır, yeni adres alanına yalnızca bu iş parçacığı geçer.
+        // Süreç önce atanır ki araya giren bağlam değişimi dizini geri yüklesin.
+        process_t* proc = process_alloc(dir);
+        if (!proc) {
+            vm_unmap_all(dir);
+            paging_destroy_directory(dir);
+            return -1;
+        }
+        proc->state = PROC_RUNNING;
+        self->process = proc;
+        paging_switch_directory(dir);
+    } else {
+        // Kullanıcı süreci: eski adres alanını bırak ve yenisine geç
+        page_directory_t* old = cur ? cur->page_dir : NULL;
+        paging_switch_directory(dir);
+        if (cur) cur->page_dir = dir;
+        if (old && old != kernel_directory) {
+            vm_unmap_all(old);
+            paging_destroy_directory(old);
+        }
+    }
 
     // Set up entry point and switch to user mode
-    uint32_t entry = (uint32_t)eh.e_entry;
-    // Use a stack within the identity-mapped 0..4MB region
-    uint32_t user_stack_top = 0x003FF000; // just below 4MB, page-aligned
-    switch_to_usermode(entry, user_stack_top);
+    switch_to_usermode(entry, ELF_USER_STACK_TOP);
 
     return 0;
 }
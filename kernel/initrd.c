@@ -278,6 +278,7 @@ int mount_initrd(uint8_t* img, size_t bytes) {
             meta->data_off = off + 512;  // payload starts after header
             meta->size = size;
             node->data = meta; // store meta pointer; tar_read uses it
+            node->inode = meta->data_off; // unique and stable within the archive
 
             vfs_node_add_child(parent, node);
 
@@ -19,6 +19,9 @@ extern void sched_init(void);  // Declaration for the scheduler initialization
 #include "include/drivers/ata.h"
 #include "include/kernel/initrd.h"
 #include "include/arch/x86/acpi.h"
+#include "include/kernel/ktime.h"
+#include "include/arch/x86/lapic.h"
+#include "include/arch/x86/smp.h"
 #include "include/drivers/keyboard.h"
 #include "include/kernel/syscall.h"
 #include "include/kernel/syscalls.h"
@@ -35,168 +38,6 @@ extern void sched_init(void);  // Declaration for the scheduler initialization
 // Forward declare userspace launcher thread function
 static void user_init_launcher(void* arg);
 
-// VGA colors
-enum vga_color {
-    VGA_COLOR_BLACK = 0,
-    VGA_COLOR_BLUE = 1,
-    VGA_COLOR_GREEN = 2,
-    VGA_COLOR_CYAN = 3,
-    VGA_COLOR_RED = 4,
-    VGA_COLOR_MAGENTA = 5,
-    VGA_COLOR_BROWN = 6,
-    VGA_COLOR_LIGHT_GREY = 7,
-    VGA_COLOR_DARK_GREY = 8,
-    VGA_COLOR_LIGHT_BLUE = 9,
-    VGA_COLOR_LIGHT_GREEN = 10,
-    VGA_COLOR_LIGHT_CYAN = 11,
-    VGA_COLOR_LIGHT_RED = 12,
-    VGA_COLOR_LIGHT_MAGENTA = 13,
-    VGA_COLOR_LIGHT_BROWN = 14,
-    VGA_COLOR_WHITE = 15
-};
-
-// VGA entry functions
-static inline uint8_t vga_entry_color(enum vga_color fg, enum vga_color bg) {
-    return fg | bg << 4;
-}
-
-static inline uint16_t vga_entry(unsigned char uc, uint8_t color) {
-    return (uint16_t) uc | (uint16_t) color << 8;
-}
-
-// String length function
-static size_t strlen_(const char* s) {
-    size_t n = 0;
-    while (s[n]) n++;
-    return n;
-}
-
-// Terminal variables
-static const size_t W = 80, H = 25;
-static size_t r, c;
-static uint8_t col;
-static uint16_t* buf;
-
-// Terminal functions
-static void term_init(void) {
-    buf = (uint16_t*)0xB8000;
-    col = vga_entry_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
-    r = 0;
-    c = 0;
-    
-    // Clear screen
-    for (size_t y = 0; y < H; y++) {
-        for (size_t x = 0; x < W; x++) {
-            const size_t index = y * W + x;
-            buf[index] = vga_entry(' ', col);
-        }
-    }
-    
-    // Move cursor to top-left
-    outb(0x3D4, 0x0F);
-    outb(0x3D5, (uint8_t)(0x00));
-    outb(0x3D4, 0x0E);
-    outb(0x3D5, (uint8_t)(0x00 >> 8));
-}
-
-static void putat(char ch, uint8_t color, size_t x, size_t y) {
-    if (x < W && y < H)
-        buf[y * W + x] = vga_entry(ch, color);
-}
-
-static void put(char ch) {
-    if (ch == '\n') {
-        c = 0;
-        r++;
-        if (r >= H) {
-            // Simple scroll - just reset to top
-            r = 0;
-        }
-        return;
-    }
-    // Handle backspace locally (ASCII 8 / '\b')
-    if (ch == '\b' || ch == 8) {
-        if (c > 0) {
-            c--;
-        } else if (r > 0) {
-            r--;
-            c = W - 1;
-        } else {
-            return; // top-left; nothing to erase
-        }
-        putat(' ', col, c, r);
-        return;
-    }
-    putat(ch, col, c, r);
-    if (++c == W) {
-        c = 0;
-        r++;
-        if (r >= H) {
-            r = 0;
-        }
-    }
-}
-
-void writes(const char* d) {
-    for (size_t i = 0; d[i]; i++) {
-        put(d[i]);
-    }
-}
-
-// Simple printf implementation
-static void itoa_unsigned(unsigned int val, unsigned int base, char* buf_out) {
-    static const char digits[] = "0123456789abcdef";
-    char tmp[32];
-    int i = 0;
-    if (val == 0) { buf_out[0] = '0'; buf_out[1] = '\0'; return; }
-    while (val && i < (int)sizeof(tmp)) { tmp[i++] = digits[val % base]; val /= base; }
-    int j = 0; while (i > 0) buf_out[j++] = tmp[--i]; buf_out[j] = '\0';
-}
-
-static void itoa_signed(int val, char* buf_out) {
-    if (val < 0) { *buf_out++ = '-'; itoa_unsigned((unsigned int)(-val), 10, buf_out); }
-    else { itoa_unsigned((unsigned int)val, 10, buf_out); }
-}
-
-static void kvprintf(const char* fmt, va_list ap) {
-    for (const char* p = fmt; *p; ++p) {
-        if (*p != '%') { put(*p); continue; }
-        ++p;
-        if (!*p) break;
-        char numbuf[34];
-        switch (*p) {
-            case 's': {
-                const char* s = va_arg(ap, const char*);
-                if (!s) s = "(null)";
-                writes(s);
-            } break;
-            case 'd': {
-                int v = va_arg(ap, int);
-                char tmp[40];
-                itoa_signed(v, tmp);
-                writes(tmp);
-            } break;
-            case 'x': {
-                unsigned int v = va_arg(ap, unsigned int);
-                itoa_unsigned(v, 16, numbuf);
-                writes(numbuf);
-            } break;
-            case 'c': {
-                int ch = va_arg(ap, int);
-                put((char)ch);
-            } break;
-            case '%': put('%'); break;
-            default: put('%'); put(*p); break;
-        }
-    }
-}
-
-void kprintf(const char* fmt, ...) {
-    va_list ap; va_start(ap, fmt);
-    kvprintf(fmt, ap);
-    va_end(ap);
-}
-
 // Kernel thread that mounts initrd from ATA disk and switches to userspace init
 static void user_init_launcher(void* arg) {
     (void)arg;
@@ -220,16 +61,6 @@ static void user_init_launcher(void* arg) {
     kernel_bsod("Kullanıcı alanı başlatılamadı!\n\ninit.elf ve sh çalıştırılamadı.\n\nMuhtemel nedenler:\n- initrd mount hatası\n- ELF yükleme/paging hatası\n- Kullanıcı programı bozuk\n\nLütfen logları kontrol edin.");
 }
 
-// Terminal functions for shell
-void terminal_clear_screen(void) {
-    for (size_t rr = 0; rr < H; rr++) {
-        for (size_t cc = 0; cc < W; cc++) {
-            putat(' ', col, cc, rr);
-        }
-    }
-    r = 0; c = 0;
-}
-
 // Simple line reading function
 int read_line(char* out, int maxlen) {
     int i = 0;
@@ -238,31 +69,22 @@ int read_line(char* out, int maxlen) {
     if (!out || maxlen <= 0) return -1;
     
     while (i < maxlen - 1) {
-        // Wait for a key from keyboard or serial
-        for (;;) {
-            int kc = keyboard_getchar_nonblock();
-            if (kc >= 0) { c = (char)kc; break; }
-            extern int serial_getchar_nonblock(void);
-            int sc = serial_getchar_nonblock();
-            if (sc >= 0) { c = (char)sc; if (c == '\r') c = '\n'; break; }
-            extern void thread_yield(void); thread_yield();
-        }
+        // Sleep until a key arrives from keyboard or serial
+        c = (char)console_getchar();
         
         // Handle backspace
         if (c == 8) {
             if (i > 0) {
                 i--;
                 // Move cursor back, print space, move cursor back again
-                put(8);   // Backspace
-                put(' '); // Space over the character
-                put(8);   // Backspace again
+                console_write("\b \b", 3);
             }
             continue;
         }
         
         // Handle enter key
         if (c == '\n') {
-            put(c); // Echo newline
+            console_write(&c, 1); // Echo newline
             out[i] = '\0';   // Null terminate
             return i;
         }
@@ -270,7 +92,7 @@ int read_line(char* out, int maxlen) {
         // Handle regular characters
         if (c >= ' ' && c <= '~') {
             out[i++] = c;
-            put(c); // Echo on VGA
+            console_write(&c, 1); // Echo on VGA
             extern void serial_write(const char*);
             char s[2] = { c, '\0' }; serial_write(s); // Echo on serial
         }
@@ -313,10 +135,10 @@ void _kernel_main(uint32_t mb_magic, uint32_t mb_info_addr) {
     vga[7] = 0x1F00 | '!';
 
     // Initialize VGA text console only
-    term_init();
+    console_init();
 
     // Log a few messages to screen and serial
-    writes("RetaOS booting in CLI mode...\n");
+    console_puts("RetaOS booting in CLI mode...\n");
     serial_write("RetaOS booting in CLI mode...\r\n");
     splash_update_progress(5);
     // Initialize GDT and then interrupt handling
@@ -326,13 +148,13 @@ void _kernel_main(uint32_t mb_magic, uint32_t mb_info_addr) {
     splash_update_progress(15);
     // Initialize interrupt handling
     idt_init();  // This will also initialize the PIC
-    writes("IDT initialized\n");
+    console_puts("IDT initialized\n");
     serial_write("[DEBUG] Initialize interrupt handling\r\n");
     splash_update_progress(25);
     // Initialize IRQ handlers (timer and keyboard) - this also sets up the timer
     extern void irq_init_basic(void);
     irq_init_basic();
-    writes("IRQ initialized\n");
+    console_puts("IRQ initialized\n");
     serial_write("[DEBUG] Initialize IRQ handlers\r\n");
     splash_update_progress(35);
     // Initialize keyboard
@@ -357,6 +179,11 @@ void _kernel_main(uint32_t mb_magic, uint32_t mb_info_addr) {
     extern void paging_init(void);
     paging_init();
     serial_write("[DEBUG] Initialize paging\r\n");
+    // Firmware tables (MADT, HPET) and the nanosecond clock
+    acpi_init();
+    ktime_init();
+    // Local APIC timer replaces the PIT as the scheduler tick when present
+    if (lapic_init() == 0) lapic_timer_init();
     splash_update_progress(65);
     // Initialize process management
     extern void process_init(void);
@@ -367,6 +194,8 @@ void _kernel_main(uint32_t mb_magic, uint32_t mb_info_addr) {
     extern void threading_init(void);
     threading_init();
     serial_write("[DEBUG] Initialize threading system\r\n");
+    // Bring up the other processors on their own GDT/TSS and idle thread
+    smp_init();
     splash_update_progress(85);
     // Initialize filesystem and (later) mount initrd
     extern void fs_init(void);
@@ -387,7 +216,7 @@ void _kernel_main(uint32_t mb_magic, uint32_t mb_info_addr) {
     sched_init();
     serial_write("[DEBUG] Initialize scheduler\r\n");
     splash_update_progress(97);
-    //writes("Initialization complete. Starting scheduler...\n");
+    //console_puts("Initialization complete. Starting scheduler...\n");
     splash_update_progress(98);
     serial_write("Initialization complete. Starting scheduler...\r\n");
     splash_update_progress(99);
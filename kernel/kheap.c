@@ -1,6 +1,8 @@
 #include <kernel/kheap.h>
-#include <kernel/pmm.h>
 #include <kernel/console.h>
+#include "include/memory/pmm.h"
+#include "include/arch/x86/paging.h"
+#include <kernel/spinlock.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
@@ -8,118 +10,388 @@
 // Global kernel heap
 heap_t *kheap = 0;
 
-// Basit bir bellek yöneticisi için blok listesi
-static heap_block_t* first_block = NULL;
+// Tüm heap durumu (binler, sınıf listeleri, sayaçlar) bu kilitle korunur;
+// kesme bağlamından da ayrılabildiği için kesmeler kapalı tutulur
+static spinlock_t heap_lock = SPINLOCK_INIT("kheap");
+
+// Büyük bloklar için boyut binleri ve dolu bin bit haritası
+static heap_block_t* bins[KHEAP_NUM_BINS];
+static uint32_t bin_map = 0;
 static uint32_t kheap_start = 0;
 static uint32_t kheap_end = 0;
 static uint32_t kheap_max = 0;
 static uint32_t kheap_inited = 0;
 
+// PMM'den eşlenen / PMM'e geri verilen sayfa sayaçları
+static uint32_t pages_mapped = 0;
+static uint32_t pages_returned = 0;
+
+// Boyut sınıfı başına boş liste ve istatistik
+static kheap_slab_obj_t* class_free[KHEAP_NUM_CLASSES];
+static kheap_class_stats_t class_stats[KHEAP_NUM_CLASSES];
+
+// Büyük blok istatistikleri
+static uint32_t large_allocs = 0;
+static uint32_t large_frees = 0;
+
 // Hizalama fonksiyonu
 static uint32_t align_up(uint32_t addr, uint32_t align) {
     return (addr + align - 1) & ~(align - 1);
 }
 
-// Kernel heap'i başlat
-void kheap_init(void) {
+// İstenen boyut için sınıf indeksi (O(1))
+static inline int size_to_class(size_t size) {
+    if (size <= (1u << KHEAP_MIN_CLASS_SHIFT)) return 0;
+    return (32 - __builtin_clz((uint32_t)size - 1)) - KHEAP_MIN_CLASS_SHIFT;
+}
+
+static inline void* block_payload(heap_block_t* block) {
+    return (void*)((uint8_t*)block + sizeof(heap_block_t));
+}
+
+// Başlık + alt etiket toplam ek yükü
+#define BLOCK_OVERHEAD (sizeof(heap_block_t) + sizeof(heap_footer_t))
+// Bölünen parçanın taşıyabileceği en küçük yük
+#define BLOCK_MIN_PAYLOAD 16
+// Kendi bininde bakılan blok sayısı; sonra daha büyük bine geçilir
+#define BIN_SCAN_LIMIT 8
+
+static inline heap_footer_t* block_footer(heap_block_t* block) {
+    return (heap_footer_t*)((uint8_t*)block_payload(block) + block->size);
+}
+
+// Bloğu verilen boyutla biçimlendir ve alt etiketi yaz
+static inline void block_format(heap_block_t* block, size_t size, uint32_t used) {
+    block->size = size;
+    block->used = used;
+    block->magic = KHEAP_BLOCK_MAGIC;
+    block_footer(block)->header = block;
+}
+
+// Fiziksel komşular: sınır etiketleri sayesinde O(1)
+static inline heap_block_t* block_next_phys(heap_block_t* block) {
+    uint32_t next = (uint32_t)block_footer(block) + sizeof(heap_footer_t);
+    return next < kheap_end ? (heap_block_t*)next : NULL;
+}
+
+static inline heap_block_t* block_prev_phys(heap_block_t* block) {
+    if ((uint32_t)block <= kheap_start) return NULL;
+    return ((heap_footer_t*)block - 1)->header;
+}
+
+static inline int size_to_bin(size_t size) {
+    return 31 - __builtin_clz((uint32_t)size);
+}
+
+// Boş bloğu kendi bininin başına ekle (LIFO, O(1)); yeni boşalan ve
+// önbellekte sıcak blok ilk tekrar kullanılır
+static void bin_insert(heap_block_t* block) {
+    int b = size_to_bin(block->size);
+    block->prev = NULL;
+    block->next = bins[b];
+    if (bins[b]) bins[b]->prev = block;
+    bins[b] = block;
+    bin_map |= (1u << b);
+}
+
+static void bin_remove(heap_block_t* block) {
+    int b = size_to_bin(block->size);
+    if (block->prev) block->prev->next = block->next;
+    else bins[b] = block->next;
+    if (block->next) block->next->prev = block->prev;
+    if (!bins[b]) bin_map &= ~(1u << b);
+    block->next = block->prev = NULL;
+}
+
+// 4MB hizalı bir adresten büyük sayfa eşlemeyi dene
+static int kheap_map_large(uint32_t va) {
+    if (!paging_pse_enabled() || va + PAGING_LARGE_SIZE > kheap_max) return -1;
+    uint32_t frame = pmm_alloc_frames(PAGING_LARGE_SIZE / KHEAP_ALIGN, PAGING_LARGE_SIZE);
+    if (!frame) return -1;
+    if (paging_map_large(va, frame, 0) < 0) {
+        pmm_free_frames(frame, PAGING_LARGE_SIZE / KHEAP_ALIGN);
+        return -1;
+    }
+    pages_mapped += PAGING_LARGE_SIZE / KHEAP_ALIGN;
+    return 0;
+}
+
+// Heap sonunu 'new_end'e çek, aradaki sayfaları PMM'e geri ver
+static void kheap_shrink(uint32_t new_end) {
+    while (kheap_end > new_end) {
+        uint32_t va = kheap_end - KHEAP_ALIGN;
+        if (paging_is_large(va)) {
+            // Büyük sayfa yalnızca tamamen boşaldığında geri verilir
+            uint32_t base = va & ~(PAGING_LARGE_SIZE - 1);
+            if (base < new_end) break;
+            pmm_free_frames(paging_unmap_large(base), PAGING_LARGE_SIZE / KHEAP_ALIGN);
+            kheap_end = base;
+            pages_mapped -= PAGING_LARGE_SIZE / KHEAP_ALIGN;
+            pages_returned += PAGING_LARGE_SIZE / KHEAP_ALIGN;
+            continue;
+        }
+        kheap_end = va;
+        uint32_t frame = paging_unmap_page(va);
+        if (frame) pmm_free_frame(frame);
+        pages_mapped--;
+        pages_returned++;
+    }
+}
+
+// Heap sonunu en az 'bytes' kadar büyüt: PMM'den çerçeve al ve eşle.
+// 4MB sınırında yeterince büyük büyümeler tek bir büyük sayfa alır.
+static int kheap_grow(uint32_t bytes) {
+    uint32_t old_end = kheap_end;
+    uint32_t target = kheap_end + align_up(bytes, KHEAP_ALIGN);
+    if (target > kheap_max || target < kheap_end) return -1;
+
+    uint32_t va = kheap_end;
+    while (va < target) {
+        if (!(va & (PAGING_LARGE_SIZE - 1)) && target - va >= KHEAP_LARGE_GROW &&
+            kheap_map_large(va) == 0) {
+            va += PAGING_LARGE_SIZE;
+            continue;
+        }
+        uint32_t frame = pmm_alloc_frame();
+        if (!frame || paging_map_page(va, frame) < 0) {
+            // Yarım kalan büyümeyi geri al
+            if (frame) pmm_free_frame(frame);
+            kheap_end = va;
+            kheap_shrink(old_end);
+            return -1;
+        }
+        pages_mapped++;
+        va += KHEAP_ALIGN;
+    }
+    kheap_end = va;
+    return 0;
+}
+
+// Kernel heap'i başlat (PMM ve sayfalama önceden hazır olmalı); kilit tutulurken çağrılır
+static void heap_setup(void) {
     if (kheap_inited) return;
-    
-    // Fiziksel bellek yöneticisini başlat
-    pmm_init();
-    
+
     // Kernel heap için bellek ayır
     kheap_start = KHEAP_START;
-    kheap_end = kheap_start + KHEAP_INITIAL_SIZE;
-    kheap_max = kheap_start + 0xFFFFF; // 1MB maksimum
-    
+    kheap_end = kheap_start;
+    kheap_max = kheap_start + KHEAP_MAX_SIZE;
+    // PSE varsa ilk 4MB tek bir büyük sayfa olarak eşlenir
+    if (kheap_map_large(kheap_start) == 0) kheap_end += PAGING_LARGE_SIZE;
+    else if (kheap_grow(KHEAP_INITIAL_SIZE) < 0) return;
+
     // İlk bloğu oluştur
-    first_block = (heap_block_t*)kheap_start;
-    first_block->size = kheap_end - kheap_start - sizeof(heap_block_t);
-    first_block->used = 0;
-    first_block->next = NULL;
-    
+    for (int i = 0; i < KHEAP_NUM_BINS; i++) bins[i] = NULL;
+    bin_map = 0;
+    heap_block_t* first_block = (heap_block_t*)kheap_start;
+    block_format(first_block, kheap_end - kheap_start - BLOCK_OVERHEAD, 0);
+    bin_insert(first_block);
+
+    // Boyut sınıflarını hazırla
+    for (int i = 0; i < KHEAP_NUM_CLASSES; i++) {
+        class_free[i] = NULL;
+        memset(&class_stats[i], 0, sizeof(class_stats[i]));
+        class_stats[i].obj_size = 1u << (KHEAP_MIN_CLASS_SHIFT + i);
+    }
+
     kheap_inited = 1;
     //kprintf("[kheap] Kernel heap initialized at 0x%x\n", kheap_start);
 }
 
-// Bellek ayırma fonksiyonu
-void* kmalloc(size_t size) {
-    if (!kheap_inited) kheap_init();
-    
-    // En küçük blok boyutu
-    if (size < sizeof(heap_block_t*)) {
-        size = sizeof(heap_block_t*);
-    }
-    
-    // Blok arama
-    heap_block_t* block = first_block;
-    heap_block_t* prev = NULL;
-    
-    while (block) {
-        if (!block->used && block->size >= size) {
-            // Blok bulundu, bölmeye çalış
-            if (block->size > size + sizeof(heap_block_t) + 4) {
-                // Yeni blok oluştur
-                heap_block_t* new_block = (heap_block_t*)((uint8_t*)block + sizeof(heap_block_t) + size);
-                new_block->size = block->size - size - sizeof(heap_block_t);
-                new_block->used = 0;
-                new_block->next = block->next;
-                
-                block->size = size;
-                block->next = new_block;
-            }
-            
-            block->used = 1;
-            return (void*)((uint8_t*)block + sizeof(heap_block_t));
-        }
-        
-        prev = block;
-        block = block->next;
-    }
-    
-    // Yeterli alan yok, genişlet
-    uint32_t new_size = align_up(size + sizeof(heap_block_t), KHEAP_ALIGN);
-    if (kheap_end + new_size > kheap_max) {
+void kheap_init(void) {
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    heap_setup();
+    spin_unlock_irqrestore(&heap_lock, flags);
+}
+
+// Boş bloğu 'size' kadar kullan, artanı yeni boş blok olarak bine geri koy
+static void* block_take(heap_block_t* block, size_t size) {
+    bin_remove(block);
+    if (block->size >= size + BLOCK_OVERHEAD + BLOCK_MIN_PAYLOAD) {
+        size_t rest = block->size - size - BLOCK_OVERHEAD;
+        block_format(block, size, 1);
+        heap_block_t* tail = (heap_block_t*)((uint8_t*)block_footer(block) + sizeof(heap_footer_t));
+        block_format(tail, rest, 0);
+        bin_insert(tail);
+    } else {
+        block->used = 1;
+    }
+    large_allocs++;
+    return block_payload(block);
+}
+
+// Büyük blok ayırma: yalnızca boş bloklar binlerde aranır
+static void* large_alloc(size_t size) {
+    size = align_up(size, sizeof(uint32_t));
+    if (size < BLOCK_MIN_PAYLOAD) size = BLOCK_MIN_PAYLOAD;
+
+    // Kendi bininde ilk uyan, en fazla BIN_SCAN_LIMIT blok
+    int b = size_to_bin(size);
+    heap_block_t* block = bins[b];
+    for (uint32_t n = 0; block && n < BIN_SCAN_LIMIT; block = block->next, n++) {
+        if (block->size >= size) return block_take(block, size);
+    }
+
+    // Daha büyük dolu bin: ilk blok kesin sığar
+    uint32_t mask = (b + 1 < KHEAP_NUM_BINS) ? (bin_map & ~((2u << b) - 1)) : 0;
+    if (mask) {
+        return block_take(bins[__builtin_ctz(mask)], size);
+    }
+
+    // Heap'i büyütmeden önce kendi binin kalanına da bak
+    for (; block; block = block->next) {
+        if (block->size >= size) return block_take(block, size);
+    }
+
+    // Yeterli alan yok, PMM'den sayfa alarak genişlet
+    uint32_t new_size = align_up(size + BLOCK_OVERHEAD, KHEAP_ALIGN);
+    block = (heap_block_t*)kheap_end;
+    heap_block_t* last = block_prev_phys(block);
+    if (kheap_grow(new_size) < 0) {
         //kprintf("[kheap] Out of memory!\n");
         return NULL;
     }
-    
-    // Yeni blok oluştur
-    heap_block_t* new_block = (heap_block_t*)kheap_end;
-    new_block->size = size;
-    new_block->used = 1;
-    new_block->next = NULL;
-    
-    if (prev) {
-        prev->next = new_block;
+    new_size = kheap_end - (uint32_t)block; // büyük sayfa daha fazlasını getirmiş olabilir
+
+    // Yeni alanı boş blok yap, sondaki boş blokla birleştir
+    if (last && !last->used) {
+        bin_remove(last);
+        block_format(last, last->size + new_size, 0);
+        block = last;
     } else {
-        first_block = new_block;
+        block_format(block, new_size - BLOCK_OVERHEAD, 0);
+    }
+    bin_insert(block);
+
+    return large_alloc(size);
+}
+
+// Büyük blok serbest bırakma: sınır etiketleriyle komşularla O(1) birleştir
+static void large_free(heap_block_t* block) {
+    if (!block->used) return; // çift kfree
+    large_frees++;
+
+    size_t size = block->size;
+
+    // Sağ komşu boşsa yut
+    heap_block_t* next = block_next_phys(block);
+    if (next && !next->used) {
+        bin_remove(next);
+        size += next->size + BLOCK_OVERHEAD;
+        next->magic = 0;
+    }
+
+    // Sol komşu boşsa ona katıl
+    heap_block_t* prev = block_prev_phys(block);
+    if (prev && !prev->used) {
+        bin_remove(prev);
+        size += prev->size + BLOCK_OVERHEAD;
+        block->magic = 0;
+        block = prev;
+    }
+
+    block_format(block, size, 0);
+
+    // Heap'in sonundaki boş blok büyüdüyse tamamen boş sayfaları geri ver
+    if (!block_next_phys(block)) {
+        uint32_t keep = align_up((uint32_t)block + BLOCK_OVERHEAD + BLOCK_MIN_PAYLOAD, KHEAP_ALIGN);
+        if (keep < kheap_start + KHEAP_INITIAL_SIZE) keep = kheap_start + KHEAP_INITIAL_SIZE;
+        if (keep < kheap_end && kheap_end - keep >= KHEAP_TRIM_THRESHOLD) {
+            kheap_shrink(keep);
+            block_format(block, kheap_end - (uint32_t)block - BLOCK_OVERHEAD, 0);
+        }
+    }
+
+    bin_insert(block);
+}
+
+// Sınıfın boş listesini yeni bir slab parçasıyla doldur
+static int slab_refill(int cls) {
+    uint32_t stride = class_stats[cls].obj_size + sizeof(kheap_slab_obj_t);
+    uint32_t chunk = KHEAP_SLAB_CHUNK;
+    if (chunk < stride * 4) chunk = stride * 4;
+
+    uint8_t* mem = (uint8_t*)large_alloc(chunk);
+    if (!mem) return -1;
+
+    uint32_t count = chunk / stride;
+    for (uint32_t i = 0; i < count; i++) {
+        kheap_slab_obj_t* obj = (kheap_slab_obj_t*)(mem + i * stride);
+        obj->tag = KHEAP_SLAB_MAGIC | (uint32_t)cls;
+        obj->next = class_free[cls];
+        class_free[cls] = obj;
+    }
+
+    class_stats[cls].chunks++;
+    class_stats[cls].total += count;
+    return 0;
+}
+
+// Bellek ayırma fonksiyonu (kilit tutulurken)
+static void* kmalloc_locked(size_t size) {
+    if (!kheap_inited) heap_setup();
+    if (!kheap_inited) return NULL;
+    if (size == 0) size = 1;
+
+    // Küçük nesneler: sınıf boş listesinden O(1)
+    if (size <= KHEAP_MAX_SMALL) {
+        int cls = size_to_class(size);
+        if (!class_free[cls] && slab_refill(cls) < 0) {
+            return NULL;
+        }
+        kheap_slab_obj_t* obj = class_free[cls];
+        class_free[cls] = obj->next;
+        class_stats[cls].in_use++;
+        class_stats[cls].allocs++;
+        return (void*)((uint8_t*)obj + sizeof(kheap_slab_obj_t));
+    }
+
+    return large_alloc(size);
+}
+
+void* kmalloc(size_t size) {
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    void* ptr = kmalloc_locked(size);
+    spin_unlock_irqrestore(&heap_lock, flags);
+    return ptr;
+}
+
+// Bellek serbest bırakma fonksiyonu (kilit tutulurken)
+static void kfree_locked(void* ptr) {
+    // İşaretçinin hemen önündeki etiket bloğun türünü belirler
+    uint32_t tag = ((uint32_t*)ptr)[-1];
+
+    if ((tag & 0xFFFFFF00u) == KHEAP_SLAB_MAGIC) {
+        int cls = (int)(tag & 0xFFu);
+        if (cls >= KHEAP_NUM_CLASSES) return;
+        kheap_slab_obj_t* obj = (kheap_slab_obj_t*)((uint8_t*)ptr - sizeof(kheap_slab_obj_t));
+        obj->next = class_free[cls];
+        class_free[cls] = obj;
+        class_stats[cls].in_use--;
+        class_stats[cls].frees++;
+        return;
+    }
+
+    if (tag == KHEAP_BLOCK_MAGIC) {
+        large_free((heap_block_t*)((uint8_t*)ptr - sizeof(heap_block_t)));
     }
-    
-    kheap_end += new_size;
-    
-    return (void*)((uint8_t*)new_block + sizeof(heap_block_t));
 }
 
-// Bellek serbest bırakma fonksiyonu
 void kfree(void* ptr) {
     if (!ptr || (uint32_t)ptr < kheap_start || (uint32_t)ptr >= kheap_end) {
         return;
     }
-    
-    heap_block_t* block = (heap_block_t*)((uint8_t*)ptr - sizeof(heap_block_t));
-    block->used = 0;
-    
-    // Ardışık boş blokları birleştir
-    heap_block_t* current = first_block;
-    while (current && current->next) {
-        if (!current->used && !current->next->used) {
-            current->size += current->next->size + sizeof(heap_block_t);
-            current->next = current->next->next;
-        } else {
-            current = current->next;
-        }
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    kfree_locked(ptr);
+    spin_unlock_irqrestore(&heap_lock, flags);
+}
+
+// İşaretçinin kullanılabilir boyutu
+static size_t kheap_usable_size(void* ptr) {
+    uint32_t tag = ((uint32_t*)ptr)[-1];
+    if ((tag & 0xFFFFFF00u) == KHEAP_SLAB_MAGIC) {
+        return class_stats[tag & 0xFFu].obj_size;
     }
+    return ((heap_block_t*)((uint8_t*)ptr - sizeof(heap_block_t)))->size;
 }
 
 // Yeniden boyutlandırma fonksiyonu
@@ -127,29 +399,29 @@ void* krealloc(void* ptr, size_t size) {
     if (!ptr) {
         return kmalloc(size);
     }
-    
+
     if (size == 0) {
         kfree(ptr);
         return NULL;
     }
-    
-    heap_block_t* block = (heap_block_t*)((uint8_t*)ptr - sizeof(heap_block_t));
-    if (block->size >= size) {
+
+    size_t old_size = kheap_usable_size(ptr);
+    if (old_size >= size) {
         return ptr; // Mevcut blok yeterli
     }
-    
+
     // Yeni bellek bloğu ayır
     void* new_ptr = kmalloc(size);
     if (!new_ptr) {
         return NULL;
     }
-    
+
     // Veriyi kopyala
-    memcpy(new_ptr, ptr, block->size);
-    
+    memcpy(new_ptr, ptr, old_size);
+
     // Eski bloğu serbest bırak
     kfree(ptr);
-    
+
     return new_ptr;
 }
 
@@ -157,11 +429,11 @@ void* krealloc(void* ptr, size_t size) {
 void* kcalloc(size_t num, size_t size) {
     size_t total = num * size;
     void* ptr = kmalloc(total);
-    
+
     if (ptr) {
         memset(ptr, 0, total);
     }
-    
+
     return ptr;
 }
 
@@ -170,10 +442,75 @@ void* kmalloc_a(size_t size) {
     return kmalloc(align_up(size, KHEAP_ALIGN));
 }
 
+// Not: heap sayfaları PMM'den tek tek alındığından yalnızca ilk sayfanın
+// fiziksel adresi döner; birden fazla sayfa fiziksel olarak bitişik olmayabilir
 void* kmalloc_ap(size_t size, uint32_t* phys) {
     void* addr = kmalloc_a(size);
     if (phys) {
-        *phys = (uint32_t)addr - 0xC0000000; // Sanal adresten fiziksel adrese dönüşüm
+        *phys = addr ? paging_get_phys((uint32_t)addr) : 0; // Sayfa tablosundan fiziksel adres
     }
     return addr;
 }
+
+// Büyüme sınırını ayarla; mevcut boyutun altına inilemez. Üst sınır per-CPU
+// scratch sayfalarının başı (altında dizin penceresi de var); yükseltirken
+// yeni eklenen aralıkta eşlenmiş sayfa (MMIO, framebuffer) olmamalı
+int kheap_set_max(uint32_t max_size) {
+    if (max_size < KHEAP_INITIAL_SIZE || max_size > PAGING_SCRATCH_BASE - KHEAP_START) return -1;
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    heap_setup();
+    int ret = -1;
+    uint32_t max = kheap_start + max_size;
+    if (max >= kheap_end && (max <= kheap_max || !paging_range_mapped(kheap_max, max))) {
+        kheap_max = max;
+        ret = 0;
+    }
+    spin_unlock_irqrestore(&heap_lock, flags);
+    return ret;
+}
+
+// Heap penceresinin şu anki sonu; sayfalama kimlik eşlemelerini buna göre denetler
+uint32_t kheap_limit(void) {
+    uint32_t max = kheap_max;
+    return max ? max : KHEAP_START + KHEAP_MAX_SIZE;
+}
+
+// Sınıf istatistiklerini kopyala
+int kheap_get_class_stats(int cls, kheap_class_stats_t* out) {
+    if (cls < 0 || cls >= KHEAP_NUM_CLASSES || !out) return -1;
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    heap_setup();
+    *out = class_stats[cls];
+    spin_unlock_irqrestore(&heap_lock, flags);
+    return 0;
+}
+
+// Heap durumunu konsola dök
+void kalloc_dump(void) {
+    // Kilit altında anlık görüntü al, yazdırmayı kilit dışında yap
+    kheap_class_stats_t cs[KHEAP_NUM_CLASSES];
+    uint32_t free_bytes = 0, free_blocks = 0, used_blocks = 0;
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    heap_setup();
+    uint32_t start = kheap_start, end = kheap_end, max = kheap_max;
+    uint32_t mapped = pages_mapped, returned = pages_returned;
+    uint32_t l_allocs = large_allocs, l_frees = large_frees;
+    memcpy(cs, class_stats, sizeof(cs));
+    for (heap_block_t* b = (heap_block_t*)kheap_start; b; b = block_next_phys(b)) {
+        if (b->used) used_blocks++;
+        else { free_blocks++; free_bytes += b->size; }
+    }
+    spin_unlock_irqrestore(&heap_lock, flags);
+
+    kprintf("kheap: 0x%x-0x%x (max 0x%x) pages=%d returned=%d large_pages=%d\n", start, end,
+            max, mapped, returned, paging_large_page_count());
+    kprintf("class size  chunks total in_use allocs frees\n");
+    for (int i = 0; i < KHEAP_NUM_CLASSES; i++) {
+        kheap_class_stats_t* s = &cs[i];
+        kprintf("%d     %d    %d     %d    %d     %d     %d\n", i, s->obj_size,
+                s->chunks, s->total, s->in_use, s->allocs, s->frees);
+    }
+
+    kprintf("large: used=%d free=%d free_bytes=%d allocs=%d frees=%d\n",
+            used_blocks, free_blocks, free_bytes, l_allocs, l_frees);
+}
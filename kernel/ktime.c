@@ -0,0 +1,79 @@
+#include <kernel/ktime.h>
+#include <kernel/timer.h>
+#include <arch/x86/hpet.h>
+#include <arch/x86/tsc.h>
+#include <stdint.h>
+
+void serial_write(const char* str);
+
+typedef enum {
+    KTIME_SRC_TICK,
+    KTIME_SRC_HPET,
+    KTIME_SRC_TSC
+} ktime_source_t;
+
+static ktime_source_t source = KTIME_SRC_TICK;
+static uint64_t hpet_base = 0;   // Counter value at ktime_init
+static uint64_t tsc_base = 0;
+
+void ktime_init(void) {
+    int have_hpet = hpet_available() || hpet_init() == 0;
+    // Calibrate after the HPET is up so it can serve as the reference
+    int have_tsc = tsc_init() == 0;
+    
+    // A TSC that changes rate with power states can't keep wall time,
+    // but ktime_cycles() stays usable for short intervals either way
+    if (have_tsc && tsc_invariant()) {
+        tsc_base = ktime_cycles();
+        source = KTIME_SRC_TSC;
+    } else if (have_hpet) {
+        hpet_base = hpet_read_counter();
+        source = KTIME_SRC_HPET;
+    } else {
+        source = KTIME_SRC_TICK;
+    }
+    serial_write("[ktime] clocksource: ");
+    serial_write(ktime_source_name());
+    serial_write("\n");
+}
+
+uint64_t ktime_get_ns(void) {
+    switch (source) {
+        case KTIME_SRC_TSC:
+            return tsc_cycles_to_ns(ktime_cycles() - tsc_base);
+        case KTIME_SRC_HPET:
+            return hpet_ticks_to_ns(hpet_read_counter() - hpet_base);
+        case KTIME_SRC_TICK:
+        default:
+            return (uint64_t)timer_ticks * (NSEC_PER_SEC / TIMER_FREQ);
+    }
+}
+
+const char* ktime_source_name(void) {
+    switch (source) {
+        case KTIME_SRC_TSC:  return "tsc";
+        case KTIME_SRC_HPET: return "hpet";
+        default:             return "tick";
+    }
+}
+
+uint32_t ktime_resolution_ns(void) {
+    if (source == KTIME_SRC_TSC) return 1;
+    if (source == KTIME_SRC_HPET) {
+        uint32_t ns = hpet_period_fs() / 1000000u;
+        return ns ? ns : 1;
+    }
+    return NSEC_PER_SEC / TIMER_FREQ;
+}
+
+void ktime_tick(void) {
+    if (source == KTIME_SRC_HPET) hpet_sync();
+}
+
+uint64_t ktime_cycles_to_ns(uint64_t cycles) {
+    return tsc_available() ? tsc_cycles_to_ns(cycles) : 0;
+}
+
+uint32_t ktime_cpu_khz(void) {
+    return tsc_khz();
+}
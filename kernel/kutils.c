@@ -4,9 +4,6 @@
 #include <arch/x86/paging.h>
 #include <kernel/types.h>
 
-// Kernel page directory (placeholder - will be set during initialization)
-page_directory_t* kernel_directory = NULL;
-
 // Simple memcpy implementation
 void* memcpy(void* dest, const void* src, size_t n) {
     unsigned char* d = (unsigned char*)dest;
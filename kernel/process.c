@@ -5,6 +5,9 @@
 #include "include/kernel/sched.h"
 #include "include/kernel/task.h"
 #include "include/kernel/vfs.h"
+#include "include/kernel/vm.h"
+#include "kernel/thread.h"
+#include "kernel/sched.h"
 #include <stdarg.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -32,7 +35,6 @@ extern page_directory_t* kernel_directory;
 
 // Forward declarations
 static void switch_page_directory(page_directory_t* dir);
-static void clone_page_directory(page_directory_t* dir);
 static void* kmalloc_a(size_t size);
 
 // İşlem listesi başı
@@ -46,18 +48,24 @@ static void* kmalloc_a(size_t size) {
     return kmalloc(size);
 }
 
-// Switch page directory
+// Sayfa dizinini değiştir; aynı dizine geçişte CR3 yeniden yüklenmez
 static void switch_page_directory(page_directory_t* dir) {
-    // Implementation should be in paging.c
-    (void)dir; // Suppress unused parameter warning
+    paging_switch_directory(dir);
 }
 
-// Clone page directory (stub implementation)
+// Sayfa dizinini klonla: çekirdek yarısı referansla paylaşılır, kullanıcı
+// yarısı copy-on-write paylaşılır (yalnızca sayfa tabloları kopyalanır)
 static page_directory_t* clone_directory(page_directory_t* src) {
-    // For now, just return the source directory
-    // A proper implementation would create a new page directory and copy the entries
-    UNUSED(src);
-    return kernel_directory;
+    page_directory_t* dir = paging_create_directory();
+    if (!dir) return NULL;
+    if (src && src == paging_current_directory() && src != kernel_directory) {
+        if (paging_cow_clone(dir) < 0 || vm_clone_regions(src, dir) < 0) {
+            vm_unmap_all(dir);
+            paging_destroy_directory(dir);
+            return NULL;
+        }
+    }
+    return dir;
 }
 
 // Map a page (stub implementation)
@@ -71,9 +79,7 @@ static void map_page(page_directory_t* dir, void* virt, void* phys, int flags) {
 
 // Boş sayfa dizini oluştur
 static page_directory_t* create_empty_page_dir(void) {
-    // For now, just return a copy of the kernel directory
-    // This should be replaced with proper page directory creation
-    return kernel_directory;
+    return paging_create_directory();
 }
 
 // İşlem yönetimini başlat
@@ -93,30 +99,41 @@ void process_init(void) {
     //kprintf("[process] Initialized process manager, init pid=%d\n", init->pid);
 }
 
-// Yeni bir işlem oluştur (fork benzeri)
-process_t* process_create(void) {
-    process_t* parent = current_process;
-    process_t* child = (process_t*)kmalloc(sizeof(process_t));
-    if (!child) return NULL;
+// Verilen adres alanıyla yeni süreç kaydı oluştur; ebeveyn mevcut süreçtir
+process_t* process_alloc(page_directory_t* dir) {
+    process_t* parent = process_current();
+    process_t* proc = (process_t*)kmalloc(sizeof(process_t));
+    if (!proc) return NULL;
     
-    memset(child, 0, sizeof(process_t));
+    memset(proc, 0, sizeof(process_t));
     
     // Temel bilgileri ayarla
-    child->pid = next_pid++;
-    child->parent_pid = parent ? parent->pid : 0;
-    child->state = PROC_NEW;
+    proc->pid = next_pid++;
+    proc->parent_pid = parent ? parent->pid : 0;
+    proc->state = PROC_NEW;
+    proc->page_dir = dir;
+    
+    // İşlem listesine ekle
+    proc->next = process_list;
+    process_list = proc;
+    return proc;
+}
+
+// Yeni bir işlem oluştur (fork benzeri)
+process_t* process_create(void) {
+    process_t* parent = process_current();
     
     // Sayfa dizinini klonla
-    child->page_dir = clone_directory(parent ? parent->page_dir : kernel_directory);
-    if (!child->page_dir) {
-        kfree(child);
+    page_directory_t* dir = clone_directory(parent ? parent->page_dir : kernel_directory);
+    if (!dir) return NULL;
+    
+    process_t* child = process_alloc(dir);
+    if (!child) {
+        vm_unmap_all(dir);
+        paging_destroy_directory(dir);
         return NULL;
     }
     
-    // İşlem listesine ekle
-    child->next = process_list;
-    process_list = child;
-    
     //kprintf("[process] Created new process pid=%d\n", child->pid);
     return child;
 }
@@ -125,62 +142,38 @@ process_t* process_create(void) {
 int process_exec(process_t* proc, const char* path) {
     if (!proc || !path) return -1;
     
-    // Open the file
-    int fd = vfs_open(path, 0);
     extern void serial_write(const char*);
-    serial_write("[process_exec] open: "); serial_write(path); serial_write("\r\n");
-    if (fd < 0) {
-        serial_write("[process_exec] vfs_open failed\r\n");
-        //kprintf("[process] Failed to open file: %s\n", path);
+    serial_write("[process_exec] exec: "); serial_write(path); serial_write("\r\n");
+
+    // Yeni adres alanına tembel yükle: dosya okunmaz, metin sayfaları
+    // ilk erişimde sayfa önbelleğinden paylaşılır
+    page_directory_t* dir = paging_create_directory();
+    if (!dir) {
         return -1;
     }
-    
-    // Get file size
-    size_t size = vfs_size(fd);
-    {
-        extern void serial_write_hex(uint32_t);
-        serial_write("[process_exec] size=0x"); serial_write_hex((uint32_t)size); serial_write("\r\n");
-    }
-    if (size == 0) {
-        serial_write("[process_exec] size==0\r\n");
-        vfs_close(fd);
-        //kprintf("[process] Empty file: %s\n", path);
+
+    uint32_t entry;
+    if (elf_map(path, dir, &entry) < 0) {
+        serial_write("[process_exec] elf_map failed\r\n");
+        paging_destroy_directory(dir);
+        //kprintf("[process] Failed to load ELF: %s\n", path);
         return -1;
     }
-    
-    // Read file into memory
-    void* file_data = kmalloc(size);
-    if (!file_data) {
-        vfs_close(fd);
-        //kprintf("[process] Out of memory for file data\n");
-        return -1;
+
+    // Eski adres alanını bırak
+    page_directory_t* old = proc->page_dir;
+    if (proc == process_current()) {
+        switch_page_directory(dir);
     }
-    
-    ssize_t r = vfs_read(fd, file_data, size);
-    if (r != (ssize_t)size) {
-        extern void serial_write_dec(uint32_t);
-        serial_write("[process_exec] vfs_read got "); serial_write_dec((uint32_t)r); serial_write(" bytes\r\n");
-        kfree(file_data);
-        vfs_close(fd);
-        //kprintf("[process] Failed to read file: %s\n", path);
-        return -1;
-    }
-    
-    vfs_close(fd);
-    
-    // Load ELF from memory
-    void* entry = elf_load(file_data, size);
-    kfree(file_data);
-    
-    if (!entry) {
-        serial_write("[process_exec] elf_load failed\r\n");
-        //kprintf("[process] Failed to load ELF: %s\n", path);
-        return -1;
+    proc->page_dir = dir;
+    if (old && old != kernel_directory) {
+        vm_unmap_all(old);
+        paging_destroy_directory(old);
     }
     
     // Initialize user context
     memset(&proc->uc, 0, sizeof(proc->uc));
-    proc->uc.eip = (uint32_t)entry;
+    proc->uc.eip = entry;
     proc->uc.eflags = 0x200; // IF=1
     proc->uc.cs = 0x23;       // User code selector (GDT entry 4, RPL=3)
     proc->uc.ss = 0x2B;       // User data selector (GDT entry 5, RPL=3)
@@ -188,16 +181,7 @@ int process_exec(process_t* proc, const char* path) {
     proc->uc.es = 0x2B;
     proc->uc.fs = 0x2B;
     proc->uc.gs = 0x2B;
-    
-    // Set up user stack (1MB area)
-    // Keep stack within identity-mapped 0..4MB area for now
-    uint32_t user_stack_top = 0x003FF000; // just below 4MB
-    uint32_t user_stack_size = 0x20000;   // 128KB stack
-    
-    // Map user stack pages
-    // Identity map for first 4MB already present; explicit mapping skipped for now
-    
-    proc->uc.esp = user_stack_top + user_stack_size - 16; // Stack top
+    proc->uc.esp = ELF_USER_STACK_TOP - 16; // Stack top
     proc->state = PROC_READY;
     
     //kprintf("[process] Loaded ELF %s at 0x%x\n", path, entry);
@@ -221,8 +205,14 @@ void process_exit(int exit_code) {
         p = p->next;
     }
     
-    // Kaynakları serbest bırak
-    // TODO: Sayfa tablolarını, dosya tanıtıcılarını serbest bırak
+    // Kaynakları serbest bırak: adres alanından çık, sayfa tablolarını geri ver
+    // TODO: Dosya tanıtıcılarını serbest bırak
+    if (proc->page_dir && proc->page_dir != kernel_directory) {
+        switch_page_directory(kernel_directory);
+        vm_unmap_all(proc->page_dir);
+        paging_destroy_directory(proc->page_dir);
+        proc->page_dir = NULL;
+    }
     
     // Eğer init süreci sonlanıyorsa, sistem durumunu değiştir
     if (proc->pid == 1) {
@@ -232,7 +222,12 @@ void process_exit(int exit_code) {
         for(;;) hlt();
     }
     
-    // Başka bir işleme geç
+    // Sürecin iş parçacığı biter; zamanlayıcı sıradakine geçer
+    if (sched_current_thread()) {
+        thread_exit(NULL);
+    }
+    
+    // Zamanlayıcı yoksa başka bir işleme geç
     process_schedule();
     
     // Buraya ulaşılmamalı
@@ -246,71 +241,61 @@ __attribute__((noreturn)) void process_switch(process_t* next) {
         for(;;) hlt();
     }
     
-    // Get current process (if any)
-    process_t* current = current_process;
-    
-    // Save current context if we have one
-    if (current) {
-        // Save EFLAGS
-        uint32_t eflags;
-        __asm__ __volatile__ ("pushfl; popl %0" : "=r" (eflags));
-        current->uc.eflags = eflags;
-        
-        // Save stack pointer
-        __asm__ __volatile__ ("movl %%esp, %0" : "=r" (current->uc.esp));
-        
-        // Save segment registers
-        uint16_t ds, es, fs, gs;
-        __asm__ __volatile__ (
-            "mov %%ds, %0\n\t"
-            "mov %%es, %1\n\t"
-            "mov %%fs, %2\n\t"
-            "mov %%gs, %3\n\t"
-            : "=r" (ds), "=r" (es), "=r" (fs), "=r" (gs)
-        );
-        current->uc.ds = ds;
-        current->uc.es = es;
-        current->uc.fs = fs;
-        current->uc.gs = gs;
-    }
+    // The user context of a process is captured when it enters the kernel
+    // (syscall/fork), not here: at this point we are on a kernel stack.
     
     // Update current process pointer
     current_process = next;
+    next->state = PROC_RUNNING;
+    switch_page_directory(next->page_dir);
     
-    // Load new process context
-    uint32_t new_esp = next->uc.esp;
-    uint32_t new_eip = next->uc.eip;
-    
-    // Switch to the new process
+    // Build the iret frame on the kernel stack from the saved user context,
+    // then restore segments and general registers (fork children resume
+    // right after their int $0x80 with eax = 0)
     __asm__ __volatile__ (
-        // Load new stack pointer
-        "movl %0, %%esp\n\t"
-        
-        // Load segment registers with user data selector (0x23)
-        "movw $0x23, %%ax\n\t"
-        "movw %%ax, %%ds\n\t"
-        "movw %%ax, %%es\n\t"
-        "movw %%ax, %%fs\n\t"
-        "movw %%ax, %%gs\n\t"
-        
-        // Push iret frame (ss, esp, eflags, cs, eip)
-        "pushl $0x23\n\t"  // ss
-        "pushl %0\n\t"     // esp
-        "pushfl\n\t"       // eflags
-        "pushl $0x1B\n\t"  // cs
-        "pushl %1\n\t"     // eip
-        
-        // Jump to new process
+        "pushl 16(%%eax)\n\t"   // ss
+        "pushl 4(%%eax)\n\t"    // esp
+        "pushl 8(%%eax)\n\t"    // eflags
+        "pushl 12(%%eax)\n\t"   // cs
+        "pushl 0(%%eax)\n\t"    // eip
+        "movl 20(%%eax), %%ebx\n\t"
+        "movw %%bx, %%ds\n\t"
+        "movl 24(%%eax), %%ebx\n\t"
+        "movw %%bx, %%es\n\t"
+        "movl 28(%%eax), %%ebx\n\t"
+        "movw %%bx, %%fs\n\t"
+        "movl 32(%%eax), %%ebx\n\t"
+        "movw %%bx, %%gs\n\t"
+        "movl 40(%%eax), %%ebx\n\t"
+        "movl 44(%%eax), %%ecx\n\t"
+        "movl 48(%%eax), %%edx\n\t"
+        "movl 52(%%eax), %%esi\n\t"
+        "movl 56(%%eax), %%edi\n\t"
+        "movl 60(%%eax), %%ebp\n\t"
+        "movl 36(%%eax), %%eax\n\t"
         "iret"
-        : 
-        : "r" (new_esp), "r" (new_eip)
-        : "memory", "eax"
+        :
+        : "a" (&next->uc)
+        : "memory"
     );
     
     // We should never get here
     for(;;) hlt();
 }
 
+// Sürecin çekirdek iş parçacığı: adres alanına geçip kullanıcı moduna döner
+static void* process_thread_entry(void* arg) {
+    process_switch((process_t*)arg);
+}
+
+// Hazır süreci zamanlayıcıya ver: kendi iş parçacığında, kaydedilmiş
+// kullanıcı bağlamından (uc) çalışmaya başlar
+int process_start(process_t* proc) {
+    if (!proc || !proc->page_dir) return -1;
+    proc->state = PROC_READY;
+    return thread_create_in(proc, process_thread_entry, proc) < 0 ? -1 : 0;
+}
+
 // İşlemleri zamanlayıcı
 void process_schedule(void) {
     process_t* next = process_list;
@@ -335,8 +320,11 @@ void process_schedule(void) {
     process_switch(next);
 }
 
-// Mevcut çalışan işlemi al
+// Mevcut çalışan işlemi al: çalışan iş parçacığının süreci (zamanlayıcı
+// başlamadan önce yalnızca kök süreç vardır)
 process_t* process_current(void) {
+    thread_t* self = sched_current_thread();
+    if (self && self->process) return self->process;
     return current_process;
 }
 
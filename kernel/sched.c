@@ -13,6 +13,9 @@
 #include <kernel/console.h>
 #include <arch/x86/io.h>
 #include <kernel/kheap.h>
+#include <arch/x86/smp.h>
+#include <kernel/spinlock.h>
+#include <kernel/ktime.h>
 
 // Forward declarations
 void console_puts(const char *str);
@@ -22,14 +25,35 @@ void kprintf(const char* fmt, ...);
 void serial_write(const char* str);
 #include <arch/x86/gdt.h>
 #include <kernel/pmm.h>
+#include <arch/x86/paging.h>
 
 // External assembly functions
 extern void switch_threads(thread_t* from, thread_t* to);
 
 // Global variables
-static thread_t* ready_queue = NULL;
-static thread_t* sleeping_threads = NULL;  // List of sleeping threads
-static thread_t* current_thread = NULL;
+// Every CPU has its own run queue: one FIFO per priority level plus a
+// bitmap of the non-empty levels, so enqueue and pick stay O(1). A CPU
+// only takes another queue's lock to steal or rebalance.
+typedef struct runqueue {
+    spinlock_t lock;
+    int active;                             // A CPU is scheduling from it
+    uint32_t cpu;
+    thread_t* head[THREAD_PRIO_LEVELS];
+    thread_t* tail[THREAD_PRIO_LEVELS];
+    uint32_t bitmap;
+    uint32_t nr_ready;
+    thread_t* current;
+    thread_t* idle;                         // NULL on the boot CPU, which idles in sched_idle()
+    thread_t* prev;                         // Switched away from; released by sched_finish_switch()
+    uint32_t balance_ticks;
+    sched_cpu_stats_t stats;
+} runqueue_t;
+
+static runqueue_t runqueues[SMP_MAX_CPUS];
+static ticketlock_t sleep_lock = TICKETLOCK_INIT("sleep");
+static thread_t** sleep_heap = NULL;      // Sleeping threads, earliest wakeup first
+static uint32_t sleep_count = 0;
+static uint32_t sleep_capacity = 0;
 static process_t* process_list = NULL;
 static process_t* current_process = NULL;
 static int sched_initialized = 0;
@@ -40,144 +64,503 @@ int rr_quantum = 5; // Time slice in timer ticks
 static tid_t next_tid = 1;
 static pid_t next_pid = 1;
 
+static const char* rq_lock_names[SMP_MAX_CPUS] = {
+    "rq0", "rq1", "rq2", "rq3", "rq4", "rq5", "rq6", "rq7"
+};
+
+// Ticks between two load-balancing passes on each CPU
+#define SCHED_BALANCE_TICKS 10
+
+// Wakeup-to-run latency, log2 buckets in ns (see schedstat.h). Updated
+// with atomic adds from every CPU's switch path.
+static uint32_t wake_latency_hist[SCHED_LAT_BUCKETS];
+
+static inline runqueue_t* this_rq(void) {
+    return &runqueues[smp_cpu_id()];
+}
+
+// Queue a thread was last put on, NULL before it was first queued
+static inline runqueue_t* thread_rq(thread_t* thread) {
+    return thread->cpu >= 0 && thread->cpu < SMP_MAX_CPUS ? &runqueues[thread->cpu] : NULL;
+}
+
+// Lowest set bit = most urgent non-empty level
+static inline int rq_first_level(runqueue_t* rq) {
+    return rq->bitmap ? __builtin_ctz(rq->bitmap) : -1;
+}
+
+// Threads queued plus the one running (the idle thread does not count)
+static inline uint32_t rq_load(runqueue_t* rq) {
+    return rq->nr_ready + (rq->current && rq->current != rq->idle);
+}
+
+// Append to the tail of the thread's priority level; rq locked
+static void rq_enqueue(runqueue_t* rq, thread_t* thread) {
+    int prio = thread->priority;
+    if (prio < 0 || prio >= THREAD_PRIO_LEVELS) prio = thread->priority = THREAD_PRIO_DEFAULT;
+    thread->rq_next = NULL;
+    thread->rq_prev = rq->tail[prio];
+    if (rq->tail[prio]) rq->tail[prio]->rq_next = thread;
+    else rq->head[prio] = thread;
+    rq->tail[prio] = thread;
+    thread->on_rq = 1;
+    thread->cpu = (int)rq->cpu;
+    // Moving between queues or levels keeps the original stamp
+    if (!thread->ready_stamp) thread->ready_stamp = ktime_cycles();
+    rq->bitmap |= 1u << prio;
+    rq->nr_ready++;
+}
+
+static void rq_dequeue(runqueue_t* rq, thread_t* thread) {
+    int prio = thread->priority;
+    if (thread->rq_prev) thread->rq_prev->rq_next = thread->rq_next;
+    else rq->head[prio] = thread->rq_next;
+    if (thread->rq_next) thread->rq_next->rq_prev = thread->rq_prev;
+    else rq->tail[prio] = thread->rq_prev;
+    if (!rq->head[prio]) rq->bitmap &= ~(1u << prio);
+    
+    thread->rq_next = thread->rq_prev = NULL;
+    thread->on_rq = 0;
+    rq->nr_ready--;
+}
+
+// Least loaded CPU that is scheduling; new threads start there
+static runqueue_t* least_loaded_rq(void) {
+    runqueue_t* best = &runqueues[0];
+    for (uint32_t i = 1; i < SMP_MAX_CPUS; i++) {
+        runqueue_t* rq = &runqueues[i];
+        if (rq->active && rq_load(rq) < rq_load(best)) best = rq;
+    }
+    return best;
+}
+
 // Thread scheduling functions
 void sched_add_thread(thread_t* thread) {
     if (!thread) return;
     
-    // Add to the front of the ready queue
-    thread->next = ready_queue;
-    ready_queue = thread;
+    uint32_t flags = irq_save();
+    // Wakeups go back to the CPU the thread last ran on (warm cache)
+    runqueue_t* rq = thread_rq(thread);
+    if (!rq || !rq->active) rq = least_loaded_rq();
+    spin_lock(&rq->lock);
+    if (!thread->on_rq) rq_enqueue(rq, thread);
+    spin_unlock(&rq->lock);
+    irq_restore(flags);
+}
+
+// Make a blocked thread runnable. Its time on the ready queue from here
+// until it is switched in is sampled into the wakeup latency histogram.
+void sched_wake_thread(thread_t* thread) {
+    if (!thread) return;
+    thread->state = THREAD_READY;
+    thread->woken = 1;
+    sched_add_thread(thread);
 }
 
 void sched_remove_thread(thread_t* thread) {
-    if (!thread || !ready_queue) return;
-    
-    // If it's the first thread in the queue
-    if (ready_queue == thread) {
-        ready_queue = ready_queue->next;
-        return;
+    runqueue_t* rq = thread ? thread_rq(thread) : NULL;
+    if (!rq) return;
+    
+    uint32_t flags = irq_save();
+    spin_lock(&rq->lock);
+    if (thread->on_rq) {
+        rq_dequeue(rq, thread);
+        thread->ready_stamp = 0;
+        thread->woken = 0;
     }
-    
-    // Find the thread in the queue
-    thread_t* prev = ready_queue;
-    while (prev->next && prev->next != thread) {
-        prev = prev->next;
+    spin_unlock(&rq->lock);
+    irq_restore(flags);
+}
+
+// First queued thread no CPU is still executing on, most urgent level
+// first. 'self' may be taken anyway: it is this CPU's own current thread.
+static thread_t* rq_take(runqueue_t* rq, thread_t* self) {
+    uint32_t levels = rq->bitmap;
+    while (levels) {
+        int prio = __builtin_ctz(levels);
+        for (thread_t* t = rq->head[prio]; t; t = t->rq_next) {
+            if (!t->on_cpu || t == self) {
+                rq_dequeue(rq, t);
+                return t;
+            }
+        }
+        levels &= levels - 1;
     }
-    
-    // Remove the thread if found
-    if (prev->next == thread) {
-        prev->next = thread->next;
+    return NULL;
+}
+
+// Busiest other active queue holding at least 'min' ready threads
+static runqueue_t* busiest_rq(runqueue_t* self, uint32_t min) {
+    runqueue_t* busiest = NULL;
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        runqueue_t* rq = &runqueues[i];
+        if (rq == self || !rq->active || rq->nr_ready < min) continue;
+        if (!busiest || rq->nr_ready > busiest->nr_ready) busiest = rq;
     }
+    return busiest;
 }
 
-// Get the next thread to run
-static thread_t* pick_next_thread(void) {
-    if (!ready_queue) return NULL;
-    
-    // Simple round-robin: move head to tail
-    thread_t* next = ready_queue;
-    ready_queue = ready_queue->next;
-    next->next = NULL;
-    
+// Take one thread off the busiest queue; 'rq' is locked. The victim is
+// only try-locked so two CPUs stealing from each other cannot deadlock.
+static thread_t* pull_thread(runqueue_t* rq, uint32_t min) {
+    runqueue_t* victim = busiest_rq(rq, min);
+    if (!victim || !spin_trylock(&victim->lock)) return NULL;
+    thread_t* t = rq_take(victim, NULL);
+    spin_unlock(&victim->lock);
+    return t;
+}
+
+// Get the next thread to run: head of the most urgent local level, or a
+// thread stolen from the busiest CPU when the local queue is empty
+static thread_t* pick_next_thread(runqueue_t* rq) {
+    thread_t* next = rq_take(rq, rq->current);
+    if (next) return next;
+    
+    next = pull_thread(rq, 1);
+    if (next) {
+        next->cpu = (int)rq->cpu;
+        rq->stats.steals++;
+    }
     return next;
 }
 
-// Add a thread to the sleeping threads list
+// Periodic pull from a CPU with at least two more ready threads than us
+static void sched_balance(runqueue_t* rq) {
+    if (++rq->balance_ticks < SCHED_BALANCE_TICKS) return;
+    rq->balance_ticks = 0;
+    
+    spin_lock(&rq->lock);
+    thread_t* t = pull_thread(rq, rq->nr_ready + 2);
+    if (t) {
+        rq_enqueue(rq, t);
+        rq->stats.balanced++;
+    }
+    spin_unlock(&rq->lock);
+}
+
+// Change a thread's priority, moving it between levels if it is queued
+int sched_set_priority(thread_t* thread, int priority) {
+    if (!thread || priority < 0 || priority >= THREAD_PRIO_LEVELS) return -1;
+    runqueue_t* rq = thread_rq(thread);
+    if (!rq) {
+        thread->priority = priority;
+        return 0;
+    }
+    
+    uint32_t flags = irq_save();
+    spin_lock(&rq->lock);
+    if (thread->on_rq) {
+        rq_dequeue(rq, thread);
+        thread->priority = priority;
+        rq_enqueue(rq, thread);
+    } else {
+        thread->priority = priority;
+    }
+    spin_unlock(&rq->lock);
+    irq_restore(flags);
+    return 0;
+}
+
+// Sleeping threads: binary min-heap keyed on wakeup_time. The tick only
+// looks at the root, so a tick with no expiring sleeper is O(1) and each
+// wakeup costs O(log n) regardless of how many threads are asleep.
+#define SLEEP_HEAP_INITIAL 16
+
+// Tick counts wrap; compare by signed distance
+static inline int wakes_before(const thread_t* a, const thread_t* b) {
+    return (int32_t)(a->wakeup_time - b->wakeup_time) < 0;
+}
+
+static inline void sleep_heap_set(uint32_t i, thread_t* t) {
+    sleep_heap[i] = t;
+    t->sleep_idx = (int)i;
+}
+
+static void sleep_heap_up(uint32_t i) {
+    thread_t* t = sleep_heap[i];
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (!wakes_before(t, sleep_heap[parent])) break;
+        sleep_heap_set(i, sleep_heap[parent]);
+        i = parent;
+    }
+    sleep_heap_set(i, t);
+}
+
+static void sleep_heap_down(uint32_t i) {
+    thread_t* t = sleep_heap[i];
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= sleep_count) break;
+        if (child + 1 < sleep_count && wakes_before(sleep_heap[child + 1], sleep_heap[child])) {
+            child++;
+        }
+        if (!wakes_before(sleep_heap[child], t)) break;
+        sleep_heap_set(i, sleep_heap[child]);
+        i = child;
+    }
+    sleep_heap_set(i, t);
+}
+
+// Take a thread out of the heap (it woke up or is being torn down)
+static void sleep_heap_remove(thread_t* thread) {
+    uint32_t i = (uint32_t)thread->sleep_idx;
+    thread->sleep_idx = -1;
+    thread_t* last = sleep_heap[--sleep_count];
+    if (i == sleep_count) return;
+    sleep_heap_set(i, last);
+    sleep_heap_up(i);
+    sleep_heap_down((uint32_t)last->sleep_idx);
+}
+
+// Add a thread to the sleeping threads heap
 void sched_add_sleeping_thread(thread_t* thread) {
-    if (!thread) return;
+    if (!thread || thread->sleep_idx >= 0) return;
+    
+    uint32_t flags = irq_save();
+    ticket_lock(&sleep_lock);
+    if (sleep_count == sleep_capacity) {
+        uint32_t cap = sleep_capacity ? sleep_capacity * 2 : SLEEP_HEAP_INITIAL;
+        thread_t** grown = (thread_t**)kmalloc(cap * sizeof(thread_t*));
+        if (!grown) {
+            // Out of memory: let it run again instead of sleeping forever
+            ticket_unlock(&sleep_lock);
+            thread->state = THREAD_READY;
+            sched_add_thread(thread);
+            irq_restore(flags);
+            return;
+        }
+        if (sleep_heap) {
+            memcpy(grown, sleep_heap, sleep_count * sizeof(thread_t*));
+            kfree(sleep_heap);
+        }
+        sleep_heap = grown;
+        sleep_capacity = cap;
+    }
     
-    thread->next_sleeping = sleeping_threads;
-    sleeping_threads = thread;
+    sleep_heap_set(sleep_count, thread);
+    sleep_heap_up(sleep_count++);
+    ticket_unlock(&sleep_lock);
+    irq_restore(flags);
 }
 
-// Check and wake up sleeping threads
+// Wake every sleeper whose deadline has passed. Runs on the boot CPU,
+// which owns the tick; woken threads go back to their own CPU's queue.
 static void check_sleeping_threads(void) {
-    thread_t** ptr = &sleeping_threads;
-    thread_t* current = sleeping_threads;
-    
-    while (current) {
-        if (current->wakeup_time <= timer_ticks) {
-            // Wake up the thread
-            *ptr = current->next_sleeping;
-            current->state = THREAD_READY;
-            sched_add_thread(current);
-            current = *ptr;
-        } else {
-            ptr = &current->next_sleeping;
-            current = current->next_sleeping;
-        }
+    uint32_t flags = irq_save();
+    ticket_lock(&sleep_lock);
+    while (sleep_count && (int32_t)(sleep_heap[0]->wakeup_time - timer_ticks) <= 0) {
+        thread_t* t = sleep_heap[0];
+        sleep_heap_remove(t);
+        sched_wake_thread(t);
     }
+    ticket_unlock(&sleep_lock);
+    irq_restore(flags);
 }
 
-// Timer tick handler - called from timer interrupt
+// Nothing is runnable: halt until the earliest sleeper is due. With
+// tickless idle the timer fires once at that deadline instead of every tick.
+#define SCHED_IDLE_MAX_TICKS 100
+
+static void sched_idle(void) {
+    ticket_lock(&sleep_lock);
+    uint32_t deadline = sleep_count ? sleep_heap[0]->wakeup_time
+                                    : timer_ticks + SCHED_IDLE_MAX_TICKS;
+    ticket_unlock(&sleep_lock);
+    timer_idle_until(deadline);
+    check_sleeping_threads();
+}
+
+// Timer tick handler - called from timer interrupt on every CPU
 void sched_tick(void) {
-    if (!current_thread) return;
+    if (!sched_initialized) return;
+    runqueue_t* rq = this_rq();
+    thread_t* current = rq->current;
+    
+    // The boot CPU owns the tick and the sleep heap
+    if (rq->cpu == 0) check_sleeping_threads();
+    sched_balance(rq);
+    
+    // An idle CPU looks for work (local or stolen) on every tick
+    if (current && current == rq->idle) {
+        sched_yield();
+        return;
+    }
+    
+    // Threads on their way to sleep/block yield themselves; don't preempt them
+    if (!current || current->state != THREAD_RUNNING) return;
     
     // Decrement the time slice
-    current_thread->time_slice--;
+    current->time_slice--;
     
     // Check if the time slice has expired
-    if (current_thread->time_slice <= 0) {
+    if (current->time_slice <= 0) {
         // Reset the time slice
-        current_thread->time_slice = rr_quantum;
+        current->time_slice = rr_quantum;
         
         // If preemption is enabled, yield the CPU
         if (preempt_enabled) {
             sched_yield();
         }
+        return;
     }
     
-    // Check for sleeping threads that need to be woken up
-    check_sleeping_threads();
+    // A more urgent thread became ready: don't wait for the slice to end
+    int prio = rq_first_level(rq);
+    if (preempt_enabled && prio >= 0 && prio < current->priority) {
+        current->time_slice = rr_quantum;
+        sched_yield();
+    }
+}
+
+// Called on the new thread's stack right after a switch: the previous
+// thread's context is now saved, so other CPUs may pick it up
+void sched_finish_switch(void) {
+    runqueue_t* rq = this_rq();
+    thread_t* prev = rq->prev;
+    rq->prev = NULL;
+    if (prev) prev->on_cpu = 0;
+    spin_unlock(&rq->lock);
+}
+
+// Cycles from 'stamp' to 'now'. TSCs of different CPUs can be a little
+// apart, so a thread that migrated may see a stamp from the future.
+static inline uint64_t cycles_since(uint64_t stamp, uint64_t now) {
+    return now > stamp ? now - stamp : 0;
+}
+
+static void wake_latency_record(uint64_t cycles) {
+    uint64_t ns = ktime_cycles_to_ns(cycles);
+    int bucket = 0;
+    if (ns >> 32) bucket = SCHED_LAT_BUCKETS - 1;
+    else if (ns) bucket = 31 - __builtin_clz((uint32_t)ns);
+    if (bucket >= SCHED_LAT_BUCKETS) bucket = SCHED_LAT_BUCKETS - 1;
+    __sync_fetch_and_add(&wake_latency_hist[bucket], 1);
+}
+
+// Charge the outgoing thread's run time and the incoming thread's wait
+static void account_switch(thread_t* prev, thread_t* next, uint64_t now) {
+    if (prev) {
+        prev->runtime_cycles += cycles_since(prev->run_stamp, now);
+        if (prev->state == THREAD_BLOCKED || prev->state == THREAD_TERMINATED) prev->nr_voluntary++;
+        else prev->nr_involuntary++;
+    }
+    // The idle thread is never queued, so it has no wait to charge
+    if (next->ready_stamp) {
+        uint64_t waited = cycles_since(next->ready_stamp, now);
+        next->wait_cycles += waited;
+        if (next->woken) wake_latency_record(waited);
+    }
+    next->ready_stamp = 0;
+    next->woken = 0;
+    next->run_stamp = now;
+    next->nr_switches++;
+}
+
+// Switch from rq->current to 'next'; rq is locked with interrupts off
+// and is unlocked by sched_finish_switch() on the other side
+static void context_switch_to(runqueue_t* rq, thread_t* next) {
+    thread_t* prev = rq->current;
+    account_switch(prev, next, ktime_cycles());
+    next->state = THREAD_RUNNING;
+    next->time_slice = rr_quantum;
+    next->cpu = (int)rq->cpu;
+    next->on_cpu = 1;
+    rq->current = next;
+    rq->stats.switches++;
+    
+    // Enter the next thread's address space. Kernel threads have no process
+    // and keep running on whatever directory is loaded; CR3 is only
+    // reloaded when the process actually changes.
+    if (next->process && next->process->page_dir) {
+        paging_switch_directory(next->process->page_dir);
+    }
+    if (next != rq->idle) {
+        tss_set_kernel_stack((uint32_t)next->stack_base + next->stack_size);
+    }
+    
+    // Perform the context switch
+    rq->prev = prev;
+    switch_threads(prev, next);
+    sched_finish_switch();
 }
 
 // Yield the CPU to another thread
 void sched_yield(void) {
     if (!sched_initialized) return;
     
-    // Get next thread to run
-    thread_t* next = pick_next_thread();
-    if (!next) return; // No other threads to run
-    
-    // Get current thread
-    thread_t* current = current_thread;
+    uint32_t flags = irq_save();
+    runqueue_t* rq = this_rq();
+    spin_lock(&rq->lock);
+    thread_t* current = rq->current;
     
-    // If current thread is still runnable, add it back to the ready queue
-    if (current && current->state == THREAD_RUNNING) {
+    // If current thread is still runnable, requeue it behind its peers
+    // before picking, so a yielding thread does not run again first
+    if (current && current != rq->idle && current->state == THREAD_RUNNING) {
         current->state = THREAD_READY;
-        sched_add_thread(current);
+        rq_enqueue(rq, current);
     }
     
-    // Switch to the next thread
-    next->state = THREAD_RUNNING;
-    next->time_slice = rr_quantum;
-    
-    // Update current thread
-    thread_t* prev_thread = current_thread;
-    current_thread = next;
-    
-    // If this is the first thread, we don't need to switch
-    if (!prev_thread) {
+    // Get next thread to run. A caller that cannot continue (blocked or
+    // exiting) hands the CPU to its idle thread; the boot CPU has none
+    // and idles right here until something wakes.
+    thread_t* next = pick_next_thread(rq);
+    while (!next && current && current != rq->idle && current->state != THREAD_READY) {
+        if (rq->idle) {
+            next = rq->idle;
+            break;
+        }
+        spin_unlock(&rq->lock);
+        sched_idle();
+        __asm__ __volatile__("cli");
+        spin_lock(&rq->lock);
+        next = pick_next_thread(rq);
+    }
+    if (!current) {
+        // Not started yet: sched_start() picks the first thread
+        if (next) rq_enqueue(rq, next);
+        next = NULL;
+    }
+    if (!next || next == current) {
+        if (next) {
+            // Still the most urgent runnable thread
+            current->ready_stamp = 0;
+            current->woken = 0;
+            current->state = THREAD_RUNNING;
+            current->time_slice = rr_quantum;
+        }
+        spin_unlock(&rq->lock);
+        irq_restore(flags);
         return;
     }
     
-    // Perform the context switch
-    switch_threads(prev_thread, next);
+    context_switch_to(rq, next);
+    irq_restore(flags);
 }
 
 // Initialize the scheduler
 void sched_init(void) {
-    // Initialize the ready queue
-    ready_queue = NULL;
+    // Initialize the ready queues. APs that are already up keep their idle
+    // thread; they start picking work once sched_initialized is set.
+    for (uint32_t i = 0; i < SMP_MAX_CPUS; i++) {
+        runqueue_t* rq = &runqueues[i];
+        memset(rq->head, 0, sizeof(rq->head));
+        memset(rq->tail, 0, sizeof(rq->tail));
+        rq->bitmap = 0;
+        rq->nr_ready = 0;
+        rq->cpu = i;
+        spin_init(&rq->lock, rq_lock_names[i]);
+    }
+    runqueues[0].active = 1;
+    runqueues[0].current = NULL;
     
-    // Initialize the sleeping threads list
-    sleeping_threads = NULL;
+    // Initialize the sleeping threads heap
+    sleep_count = 0;
     
     // Initialize the process list
     process_list = NULL;
     
-    // No current thread or process yet
-    current_thread = NULL;
+    // No current process yet
     current_process = NULL;
     
     // Initialize the task ID counter
@@ -196,6 +579,23 @@ void sched_init(void) {
     //kprintf("[sched] Scheduler initialized\n");
 }
 
+// Scheduler loop of an application processor, running on its idle thread
+void sched_ap_main(thread_t* idle) {
+    runqueue_t* rq = this_rq();
+    rq->cpu = smp_cpu_id();
+    idle->cpu = (int)rq->cpu;
+    idle->on_cpu = 1;
+    idle->run_stamp = ktime_cycles();
+    rq->idle = idle;
+    rq->current = idle;
+    rq->active = 1;
+    
+    for (;;) {
+        sched_yield();
+        __asm__ __volatile__("sti; hlt");
+    }
+}
+
 // Alias for scheduler_init for backward compatibility
 void scheduler_init(void) {
     sched_init();
@@ -208,21 +608,27 @@ void scheduler_start(void) {
 
 // Start the scheduler
 void sched_start(void) {
-    // Make sure we have at least one thread
-    if (!ready_queue) {
+    runqueue_t* rq = this_rq();
+    
+    // Get the first thread to run
+    uint32_t flags = irq_save();
+    spin_lock(&rq->lock);
+    thread_t* next = pick_next_thread(rq);
+    if (!next) {
+        spin_unlock(&rq->lock);
+        irq_restore(flags);
         serial_write("[DEBUG] No threads to schedule!\r\n");
         return;
     }
     
-    // Get the first thread to run
-    thread_t* next = ready_queue;
-    ready_queue = ready_queue->next;
-    
     serial_write("[DEBUG] Starting scheduler with first thread\r\n");
     
-    // Mark it as running
+    // Mark it as running; thread_entry releases the lock
+    account_switch(NULL, next, ktime_cycles());
     next->state = THREAD_RUNNING;
-    current_thread = next;
+    next->cpu = (int)rq->cpu;
+    next->on_cpu = 1;
+    rq->current = next;
     
     // Update TSS
     tss_set_kernel_stack((uint32_t)next->stack_base + next->stack_size);
@@ -239,7 +645,47 @@ void sched_start(void) {
 
 // Get current thread
 thread_t* sched_current_thread(void) {
-    return current_thread;
+    uint32_t flags = irq_save();
+    thread_t* t = this_rq()->current;
+    irq_restore(flags);
+    return t;
+}
+
+void sched_get_cpu_stats(uint32_t cpu, sched_cpu_stats_t* out) {
+    if (!out || cpu >= SMP_MAX_CPUS) return;
+    runqueue_t* rq = &runqueues[cpu];
+    *out = rq->stats;
+    out->nr_ready = rq->nr_ready;
+    out->active = rq->active;
+}
+
+// Snapshot a thread's accounting. A thread that is on a CPU right now
+// also gets the part of its slice that has run so far.
+void sched_get_thread_stats(thread_t* thread, sched_stat_t* out) {
+    if (!thread || !out) return;
+    uint32_t flags = irq_save();
+    uint64_t now = ktime_cycles();
+    uint64_t runtime = thread->runtime_cycles;
+    uint64_t wait = thread->wait_cycles;
+    if (thread->on_cpu) runtime += cycles_since(thread->run_stamp, now);
+    else if (thread->on_rq && thread->ready_stamp) wait += cycles_since(thread->ready_stamp, now);
+    out->tid = (uint32_t)thread->tid;
+    out->state = (uint32_t)thread->state;
+    out->cpu = thread->cpu;
+    out->priority = thread->priority;
+    out->runtime_ns = ktime_cycles_to_ns(runtime);
+    out->wait_ns = ktime_cycles_to_ns(wait);
+    out->switches = thread->nr_switches;
+    out->voluntary = thread->nr_voluntary;
+    out->involuntary = thread->nr_involuntary;
+    irq_restore(flags);
+}
+
+// Copy up to 'buckets' entries of the wakeup latency histogram
+void sched_get_latency_hist(uint32_t* out, uint32_t buckets) {
+    if (!out) return;
+    if (buckets > SCHED_LAT_BUCKETS) buckets = SCHED_LAT_BUCKETS;
+    for (uint32_t i = 0; i < buckets; i++) out[i] = wake_latency_hist[i];
 }
 
 // Get current process
@@ -296,24 +742,26 @@ void sched_remove_process(process_t* proc) {
 void sched_switch(thread_t* next) {
     if (!next || next->state != THREAD_READY) return;
     
-    thread_t* current = current_thread;
-    if (current == next) return;
+    uint32_t flags = irq_save();
+    runqueue_t* rq = this_rq();
+    spin_lock(&rq->lock);
+    thread_t* current = rq->current;
+    // Only threads queued here (and not mid-switch elsewhere) can be taken
+    if (current == next || !current || !next->on_rq || next->cpu != (int)rq->cpu || next->on_cpu) {
+        spin_unlock(&rq->lock);
+        irq_restore(flags);
+        return;
+    }
+    rq_dequeue(rq, next);
     
     // Update states
-    if (current) {
+    if (current != rq->idle && current->state == THREAD_RUNNING) {
         current->state = THREAD_READY;
-        sched_add_thread(current);
+        rq_enqueue(rq, current);
     }
     
-    next->state = THREAD_RUNNING;
-    next->time_slice = rr_quantum;
-    current_thread = next;
-    
-    // Update TSS
-    tss_set_kernel_stack((uint32_t)next->stack_base + next->stack_size);
-    
-    // Perform the context switch
-    switch_threads(current, next);
+    context_switch_to(rq, next);
+    irq_restore(flags);
 }
 
 // Assembly function to switch to a thread
@@ -355,12 +803,19 @@ void scheduler_set_quantum(int ticks) { if (ticks > 0) rr_quantum = ticks; }
 // We enumerate using the thread module's global list
 extern thread_t* thread_list_head(void);
 int scheduler_task_count(void) {
-    int count = 0; thread_t* t = thread_list_head();
+    int count = 0;
+    uint32_t flags = thread_list_lock();
+    thread_t* t = thread_list_head();
     while (t) { count++; t = t->next; }
+    thread_list_unlock(flags);
     return count;
 }
 int scheduler_current_index(void) {
-    int idx = 0; thread_t* t = thread_list_head();
-    while (t) { if (t == current_thread) return idx; idx++; t = t->next; }
-    return -1;
+    int idx = 0, found = -1;
+    thread_t* current = sched_current_thread();
+    uint32_t flags = thread_list_lock();
+    thread_t* t = thread_list_head();
+    while (t) { if (t == current) { found = idx; break; } idx++; t = t->next; }
+    thread_list_unlock(flags);
+    return found;
 }
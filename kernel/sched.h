@@ -5,6 +5,7 @@
 #include <kernel/thread.h>
 #include <kernel/process.h>
 #include <kernel/scheduler.h>  // Include scheduler interface
+#include <kernel/schedstat.h>
 
 // Scheduler functions
 void sched_init(void);
@@ -13,10 +14,33 @@ void sched_start(void);
 // Thread scheduling
 void sched_add_thread(thread_t* thread);
 void sched_remove_thread(thread_t* thread);
+// Make a blocked thread runnable (samples its wakeup latency)
+void sched_wake_thread(thread_t* thread);
 void sched_yield(void);
 thread_t* sched_current_thread(void);
 void sched_switch(thread_t* next);
 void sched_add_sleeping_thread(thread_t* thread);
+int sched_set_priority(thread_t* thread, int priority);
+// Release the run queue after a context switch (new threads call it first)
+void sched_finish_switch(void);
+// Scheduler loop of an application processor on its idle thread
+void sched_ap_main(thread_t* idle);
+
+// Per-CPU scheduler counters
+typedef struct {
+    uint32_t switches;   // Context switches on this CPU
+    uint32_t steals;     // Threads taken from another CPU while idle
+    uint32_t balanced;   // Threads pulled by the periodic rebalance
+    uint32_t nr_ready;   // Threads currently queued
+    int active;          // The CPU is scheduling
+} sched_cpu_stats_t;
+
+void sched_get_cpu_stats(uint32_t cpu, sched_cpu_stats_t* out);
+
+// Per-thread run/wait time and switch counts, and the global wakeup
+// latency histogram (SCHED_LAT_BUCKETS log2 buckets)
+void sched_get_thread_stats(thread_t* thread, sched_stat_t* out);
+void sched_get_latency_hist(uint32_t* out, uint32_t buckets);
 
 // Process scheduling
 void sched_add_process(process_t* proc);
@@ -4,7 +4,18 @@
 #include "../include/kernel/vfs.h"
 #include "../include/arch/x86/acpi.h"
 #include <kernel/thread.h>
+#include <kernel/sched.h>
+#include <kernel/spinlock.h>
 #include <kernel/process.h>
+#include <kernel/kheap.h>
+#include "../include/memory/pmm.h"
+#include "../include/arch/x86/paging.h"
+#include "../include/kernel/vm.h"
+#include "../include/kernel/timer.h"
+#include "../include/kernel/ktime.h"
+#include "../include/kernel/console.h"
+#include "../include/arch/x86/tsc.h"
+#include "../include/arch/x86/smp.h"
 #include <stdarg.h>
 #include <stdint.h>
 #include <stddef.h>
@@ -13,10 +24,7 @@
 
 // Forward declarations
 extern void kprintf(const char* fmt, ...);
-extern void writes(const char* s);
-extern void put(char c);
 extern int read_line(char* out, int maxlen);
-extern void terminal_clear_screen(void);
 
 // Simple string comparison
 static int kstrcmp(const char* a, const char* b) {
@@ -27,6 +35,188 @@ static int kstrcmp(const char* a, const char* b) {
     return *a - *b;
 }
 
+// Allocate every free frame, then free them all, and report cycles per op
+static void pmm_bench(void) {
+    uint32_t max = pmm_total_frame_count();
+    uint32_t* frames = (uint32_t*)kmalloc(max * sizeof(uint32_t));
+    if (!frames) { console_puts("pmmbench: out of memory\n"); return; }
+
+    uint64_t t0 = ktime_cycles();
+    uint32_t n = 0;
+    while (n < max) {
+        uint32_t f = pmm_alloc_frame();
+        if (!f) break;
+        frames[n++] = f;
+    }
+    uint64_t t1 = ktime_cycles();
+    for (uint32_t i = 0; i < n; i++) pmm_free_frame(frames[i]);
+    uint64_t t2 = ktime_cycles();
+    kfree(frames);
+
+    uint32_t alloc_cyc = n ? (uint32_t)(t1 - t0) / n : 0;
+    uint32_t free_cyc = n ? (uint32_t)(t2 - t1) / n : 0;
+    kprintf("pmmbench: %d frames (%d KB), alloc %d cycles/frame, free %d cycles/frame\n",
+            n, n * 4, alloc_cyc, free_cyc);
+}
+
+// Physical memory fragmentation summary
+static void pmm_frag(void) {
+    pmm_frag_stats_t st;
+    pmm_get_frag_stats(&st);
+    kprintf("free=%d frames runs=%d largest=%d\n", st.free_frames, st.free_runs, st.largest_run);
+    for (int k = 0; k <= PMM_MAX_ORDER; k++) {
+        kprintf("  order %d (%d KB): %d blocks\n", k, 4 << k, st.free_blocks[k]);
+    }
+}
+
+// Per-zone physical memory usage, in KB
+static void pmm_meminfo(void) {
+    for (int z = 0; z < PMM_ZONE_COUNT; z++) {
+        const pmm_zone_t* zone = pmm_get_zone(z);
+        if (!zone->present_frames) continue;
+        kprintf("%s: present=%d KB free=%d KB used=%d KB\n", zone->name,
+                zone->present_frames * 4, zone->free_frames * 4,
+                (zone->present_frames - zone->free_frames) * 4);
+    }
+    kprintf("total: free=%d KB used=%d KB\n", pmm_free_frame_count() * 4, pmm_used_frame_count() * 4);
+    uint32_t shared, copied, reused;
+    paging_get_cow_stats(&shared, &copied, &reused);
+    kprintf("cow: shared=%d copied=%d reused=%d\n", shared, copied, reused);
+    vm_stats_t vs;
+    vm_get_stats(&vs);
+    kprintf("demand: regions=%d faults=%d file=%d zero=%d\n", vs.regions, vs.faults, vs.file_pages, vs.zero_pages);
+    kprintf("pcache: pages=%d hits=%d\n", vs.cached_pages, vs.cache_hits);
+}
+
+// Address-space switch cost: bounce between the kernel directory and a
+// fresh one, touching a page after each reload so TLB refill is included
+#define CR3_BENCH_ROUNDS 1000
+static void cr3_bench(void) {
+    uint32_t* home = paging_current_directory();
+    uint32_t* dir = paging_create_directory();
+    if (!dir) { console_puts("cr3bench: cannot create directory\n"); return; }
+    volatile uint32_t* probe = (volatile uint32_t*)kmalloc(sizeof(uint32_t));
+    if (!probe) { paging_destroy_directory(dir); console_puts("cr3bench: out of memory\n"); return; }
+
+    paging_switch_stats_t before, after;
+    paging_get_switch_stats(&before);
+    uint64_t t0 = ktime_cycles();
+    for (int i = 0; i < CR3_BENCH_ROUNDS; i++) {
+        paging_switch_directory(dir);
+        (void)*probe;
+        paging_switch_directory(home);
+        (void)*probe;
+    }
+    uint32_t cycles = (uint32_t)(ktime_cycles() - t0);
+    // Same directory again: should be skipped without touching CR3
+    paging_switch_directory(home);
+    paging_get_switch_stats(&after);
+
+    kfree((void*)probe);
+    paging_destroy_directory(dir);
+
+    uint32_t reloads = after.switches - before.switches;
+    kprintf("cr3bench: %d reloads, %d cycles/switch incl. TLB refill, %d cycles last CR3 write, %d skipped\n",
+            reloads, cycles / (2 * CR3_BENCH_ROUNDS), after.last_cycles, after.skipped - before.skipped);
+    kprintf("address spaces: %d live, %d reloads total\n", after.directories, after.switches);
+}
+
+// Throughput of N CPU-bound kernel threads for N = 1, 2, 4 .. 2x the
+// online CPUs. Each counter sits on its own cache line so the threads do
+// not slow each other down through false sharing.
+#define CPU_BENCH_MS      500
+#define CPU_BENCH_THREADS 16
+#define CPU_BENCH_SPIN    1000
+typedef struct {
+    volatile uint32_t ops;
+    uint8_t pad[60];
+} cpu_bench_slot_t;
+static cpu_bench_slot_t cpu_bench_slots[CPU_BENCH_THREADS] __attribute__((aligned(64)));
+static volatile int cpu_bench_stop;
+
+static void* cpu_bench_worker(void* arg) {
+    cpu_bench_slot_t* slot = (cpu_bench_slot_t*)arg;
+    while (!cpu_bench_stop) {
+        for (int i = 0; i < CPU_BENCH_SPIN; i++) __asm__ __volatile__("" ::: "memory");
+        slot->ops++;
+    }
+    return NULL;
+}
+
+static void cpu_bench(void) {
+    uint32_t cpus = smp_cpu_count();
+    uint32_t max = cpus * 2 > CPU_BENCH_THREADS ? CPU_BENCH_THREADS : cpus * 2;
+    uint32_t base = 0;
+    tid_t tids[CPU_BENCH_THREADS];
+
+    kprintf("cpubench: %d CPUs, %dms per run\n", (int)cpus, CPU_BENCH_MS);
+    for (uint32_t n = 1; n <= max; n *= 2) {
+        cpu_bench_stop = 0;
+        uint32_t started = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            cpu_bench_slots[i].ops = 0;
+            tids[i] = thread_create(cpu_bench_worker, &cpu_bench_slots[i]);
+            if (tids[i] > 0) started++;
+        }
+        thread_sleep(CPU_BENCH_MS);
+        cpu_bench_stop = 1;
+
+        uint32_t total = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            if (tids[i] > 0) thread_join(tids[i], NULL);
+            total += cpu_bench_slots[i].ops;
+        }
+        uint32_t rate = total * (1000 / CPU_BENCH_MS);
+        if (n == 1) base = rate ? rate : 1;
+        uint32_t speedup = rate * 10 / base;
+        kprintf("  threads=%d ops/s=%d speedup=%d.%dx\n", (int)started, (int)rate,
+                (int)(speedup / 10), (int)(speedup % 10));
+    }
+}
+
+// Console output throughput: the same text written a byte at a time
+// through console_putc() and in a single console_write() call
+#define CON_BENCH_LINES 200
+#define CON_BENCH_COLS  72
+static char con_bench_buf[CON_BENCH_LINES * (CON_BENCH_COLS + 1)];
+
+static uint32_t con_bench_rate(uint32_t bytes, uint64_t cycles) {
+    uint32_t us = (uint32_t)ktime_div_u64(ktime_cycles_to_ns(cycles), NSEC_PER_USEC, NULL);
+    return us ? (uint32_t)ktime_div_u64((uint64_t)bytes * 1000000u, us, NULL) : 0;
+}
+
+static void con_bench(void) {
+    uint32_t len = 0;
+    for (int l = 0; l < CON_BENCH_LINES; l++) {
+        for (int i = 0; i < CON_BENCH_COLS; i++) con_bench_buf[len++] = (char)('a' + (l + i) % 26);
+        con_bench_buf[len++] = '\n';
+    }
+
+    uint64_t t0 = ktime_cycles();
+    for (uint32_t i = 0; i < len; i++) console_putc(con_bench_buf[i]);
+    uint64_t t1 = ktime_cycles();
+    console_write(con_bench_buf, len);
+    uint64_t t2 = ktime_cycles();
+
+    kprintf("conbench: %d bytes, putc %d bytes/s, console_write %d bytes/s\n", (int)len,
+            (int)con_bench_rate(len, t1 - t0), (int)con_bench_rate(len, t2 - t1));
+}
+
+// Non-empty buckets of the wakeup-to-run latency histogram, labelled
+// with the bucket's lower bound
+static void print_wake_latency(void) {
+    uint32_t hist[SCHED_LAT_BUCKETS];
+    sched_get_latency_hist(hist, SCHED_LAT_BUCKETS);
+    kprintf("wakeup latency:\n");
+    for (int i = 0; i < SCHED_LAT_BUCKETS; i++) {
+        if (!hist[i]) continue;
+        uint32_t lo = 1u << i;
+        if (lo >= NSEC_PER_MSEC) kprintf("  >=%dms %d\n", (int)(lo / NSEC_PER_MSEC), (int)hist[i]);
+        else if (lo >= NSEC_PER_USEC) kprintf("  >=%dus %d\n", (int)(lo / NSEC_PER_USEC), (int)hist[i]);
+        else kprintf("  >=%dns %d\n", (int)(i ? lo : 0), (int)hist[i]);
+    }
+}
+
 // Simple shell thread function
 void shell_thread(void* arg) {
     (void)arg;
@@ -34,25 +224,35 @@ void shell_thread(void* arg) {
     
     // Debug: Add serial output to trace shell thread execution
     serial_write("[DEBUG] Shell thread started!\r\n");
-    writes("\nRetaOS Kernel Shell - Type 'help' for commands\n\n");
+    console_puts("\nRetaOS Kernel Shell - Type 'help' for commands\n\n");
     serial_write("RetaOS Kernel Shell - Type 'help' for commands\r\n\r\n");
     serial_write("[DEBUG] Shell welcome message written\r\n");
     
     for(;;) {
-        writes("RetaOSKernel> ");
+        console_puts("RetaOSKernel> ");
         serial_write("RetaOSKernel> ");
         int n = read_line(line, LINE_MAX);
         if (n <= 0) continue;
         
         // Simple command parsing
         if (kstrcmp(line, "help") == 0) {
-            writes("Available commands:\n");
-            writes("  help     - show this help\n");
-            writes("  clear    - clear screen\n");
-            writes("  version  - show kernel version\n");
-            writes("  ps       - show process status\n");
+            console_puts("Available commands:\n");
+            console_puts("  help     - show this help\n");
+            console_puts("  clear    - clear screen (PgUp/PgDn scroll back)\n");
+            console_puts("  version  - show kernel version\n");
+            console_puts("  ps       - show threads, run/wait time and wakeup latency\n");
+            console_puts("  heap     - show kernel heap size-class stats\n");
+            console_puts("  pmmbench - allocate and free all physical frames\n");
+            console_puts("  frag     - show physical memory fragmentation\n");
+            console_puts("  meminfo  - show physical memory per zone\n");
+            console_puts("  cr3bench - measure address-space switch cost\n");
+            console_puts("  timer    - tick count and tickless idle stats\n");
+            console_puts("  cpus     - show online processors and run queues\n");
+            console_puts("  cpubench - CPU-bound thread throughput vs. thread count\n");
+            console_puts("  locks    - show lock acquisitions and contention\n");
+            console_puts("  conbench - console output bytes/sec, per-char vs. bulk\n");
         } else if (kstrcmp(line, "clear") == 0) {
-            terminal_clear_screen();
+            console_clear();
         } else if (kstrcmp(line, "version") == 0) {
             kprintf("RetaOS Kernel v1.0\n");
         } else if (kstrcmp(line, "ps") == 0) {
@@ -64,9 +264,8 @@ void shell_thread(void* arg) {
             kprintf("tasks=%d current_index=%d quantum=%d preempt=%d\n", cnt, curi, q, pre);
 
             // Enumerate threads
-            extern void writes(const char*);
-            writes("TID   PID   STATE      SLICE\n");
-            writes("------------------------------\n");
+            console_puts("TID PID STATE SLICE PRIO CPU RUN-ms WAIT-ms SWITCH VOL INVOL\n");
+            uint32_t tl = thread_list_lock();
             thread_t* t = thread_list_head();
             while (t) {
                 const char* st = "?";
@@ -78,9 +277,57 @@ void shell_thread(void* arg) {
                     case THREAD_TERMINATED: st = "TERM"; break;
                 }
                 int pid = t->process ? (int)t->process->pid : 0;
-                kprintf("%-5d %-5d %-9s %5d\n", (int)t->tid, pid, st, t->time_slice);
+                sched_stat_t ss;
+                sched_get_thread_stats(t, &ss);
+                kprintf("%d %d %s %d %d %d %d %d %d %d %d\n", (int)t->tid, pid, st, t->time_slice,
+                        t->priority, t->cpu, (int)ktime_div_u64(ss.runtime_ns, NSEC_PER_MSEC, NULL),
+                        (int)ktime_div_u64(ss.wait_ns, NSEC_PER_MSEC, NULL), (int)ss.switches,
+                        (int)ss.voluntary, (int)ss.involuntary);
                 t = t->next;
             }
+            thread_list_unlock(tl);
+            print_wake_latency();
+        } else if (kstrcmp(line, "heap") == 0) {
+            kalloc_dump();
+        } else if (kstrcmp(line, "pmmbench") == 0) {
+            pmm_bench();
+        } else if (kstrcmp(line, "frag") == 0) {
+            pmm_frag();
+        } else if (kstrcmp(line, "meminfo") == 0) {
+            pmm_meminfo();
+        } else if (kstrcmp(line, "cr3bench") == 0) {
+            cr3_bench();
+        } else if (kstrcmp(line, "timer") == 0) {
+            timer_idle_stats_t ts;
+            timer_get_idle_stats(&ts);
+            kprintf("ticks=%d device=%s tickless=%d avoided=%d idle=%d early=%d\n", (int)timer_get_ticks(),
+                    timer_device_name(), ts.tickless, ts.avoided_ticks, ts.idle_entries, ts.idle_early);
+            uint32_t us;
+            uint32_t ms = (uint32_t)ktime_div_u64(ktime_get_ns(), NSEC_PER_MSEC, &us);
+            kprintf("clock=%s res=%dns uptime=%dms+%dus\n", ktime_source_name(),
+                    (int)ktime_resolution_ns(), (int)ms, (int)(us / NSEC_PER_USEC));
+            kprintf("tsc=%dkHz invariant=%d\n", (int)ktime_cpu_khz(), tsc_invariant());
+        } else if (kstrcmp(line, "cpus") == 0) {
+            kprintf("%d of %d CPUs online\n", (int)smp_cpu_count(), (int)smp_cpu_present());
+            for (uint32_t i = 0; i < smp_cpu_present(); i++) {
+                cpu_t* c = smp_cpu(i);
+                sched_cpu_stats_t st;
+                sched_get_cpu_stats(i, &st);
+                kprintf("  cpu%d apic=%d %s idle=%d ready=%d switches=%d steals=%d balanced=%d\n",
+                        (int)c->index, (int)c->apic_id, c->online ? "online" : "offline",
+                        c->idle ? (int)c->idle->tid : 0, (int)st.nr_ready, (int)st.switches,
+                        (int)st.steals, (int)st.balanced);
+            }
+        } else if (kstrcmp(line, "cpubench") == 0) {
+            cpu_bench();
+        } else if (kstrcmp(line, "locks") == 0) {
+            lock_dump();
+        } else if (kstrcmp(line, "conbench") == 0) {
+            con_bench();
+        } else if (kstrcmp(line, "tickless on") == 0) {
+            timer_set_tickless(1);
+        } else if (kstrcmp(line, "tickless off") == 0) {
+            timer_set_tickless(0);
         } else {
             kprintf("Unknown command: %s\n", line);
         }
@@ -0,0 +1,75 @@
+#include <kernel/spinlock.h>
+#include <kernel/ktime.h>
+#include <arch/x86/paging.h>
+#include <stddef.h>
+
+void kprintf(const char* fmt, ...);
+
+// Registered locks, newest first. Entries are only ever pushed.
+static lock_stats_t* volatile lock_list = NULL;
+
+static void stats_init(lock_stats_t* stats, const char* name, uint32_t kind) {
+    stats->name = name;
+    stats->kind = kind;
+    stats->acquisitions = 0;
+    stats->contended = 0;
+    stats->spin_cycles = 0;
+}
+
+void spin_init(spinlock_t* lock, const char* name) {
+    lock->locked = 0;
+    stats_init(&lock->stats, name, LOCK_KIND_SPIN);
+}
+
+void ticket_init(ticketlock_t* lock, const char* name) {
+    lock->next = 0;
+    lock->owner = 0;
+    stats_init(&lock->stats, name, LOCK_KIND_TICKET);
+}
+
+// Called by the lock holder, so two CPUs never register the same lock;
+// the list push itself is lock-free
+void lock_register(lock_stats_t* stats) {
+    stats->registered = 1;
+    lock_stats_t* head;
+    do {
+        head = lock_list;
+        stats->next = head;
+    } while (!__sync_bool_compare_and_swap(&lock_list, head, stats));
+}
+
+void spin_lock_slow(spinlock_t* lock) {
+    uint64_t t0 = ktime_cycles();
+    do {
+        // Spin on a plain read so waiters share the cache line. Interrupts
+        // may be off, so answer TLB shootdowns here: the initiator can be
+        // the holder of this very lock.
+        while (lock->locked) {
+            paging_tlb_poll();
+            __asm__ __volatile__("pause");
+        }
+    } while (__sync_lock_test_and_set(&lock->locked, 1));
+    lock->stats.contended++;
+    lock->stats.spin_cycles += ktime_cycles() - t0;
+}
+
+void ticket_lock_slow(ticketlock_t* lock, uint16_t ticket) {
+    uint64_t t0 = ktime_cycles();
+    while (__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) != ticket) {
+        paging_tlb_poll();
+        __asm__ __volatile__("pause");
+    }
+    lock->stats.contended++;
+    lock->stats.spin_cycles += ktime_cycles() - t0;
+}
+
+void lock_dump(void) {
+    kprintf("lock kind acquired contended spin-kcycles avg-spin-cycles\n");
+    for (lock_stats_t* s = lock_list; s; s = s->next) {
+        uint32_t kcycles = (uint32_t)ktime_div_u64(s->spin_cycles, 1000, NULL);
+        uint32_t avg = s->contended ? (uint32_t)ktime_div_u64(s->spin_cycles, s->contended, NULL) : 0;
+        kprintf("%s %s %d %d %d %d\n", s->name ? s->name : "?",
+                s->kind == LOCK_KIND_TICKET ? "ticket" : "spin",
+                (int)s->acquisitions, (int)s->contended, (int)kcycles, (int)avg);
+    }
+}
@@ -8,12 +8,14 @@
 #include <drivers/keyboard.h>
 #include <kernel/console.h>
 #include <kernel/thread.h>
+#include <kernel/ktime.h>
 #include <gui/display.h>
 #include <gui/fb.h>
 #include <arch/x86/isr.h>    // isr_context yapısı için
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 #include <gui/display.h>
 #include <gui/fb.h>
 
@@ -25,9 +27,17 @@ int32_t sys_fb_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t rgb
 // Maksimum syscall sayısı
 #define MAX_SYSCALLS 256
 
+// write(1/2) kullanıcı verisini bu boyutta parçalarla çekirdek yığınına kopyalar
+#define SYS_WRITE_CHUNK 256
+
 // Syscall işleyici tablosu
 static syscall_handler_t syscall_table[MAX_SYSCALLS] = {0};
 
+// fork ve execve kullanıcı kayıtlarına ve iret çerçevesine erişir; tablo
+// yerine syscall_handler bağlamı doğrudan verir
+static int32_t sys_fork(struct isr_context* ctx);
+static int32_t sys_execve(struct isr_context* ctx, const char* path);
+
 // Syscall işleyicisini kaydet
 void syscall_register(uint32_t num, syscall_handler_t handler) {
     if (num < MAX_SYSCALLS) {
@@ -47,6 +57,9 @@ int32_t syscall_dispatch(uint32_t num, uint32_t arg1, uint32_t arg2,
 // Syscall handler - isr.S'den çağrılır
 int32_t syscall_handler(struct isr_context* ctx) {
     uint32_t num = ctx->eax;
+    if (num == SYS_FORK) return sys_fork(ctx);
+    if (num == SYS_EXECVE) return sys_execve(ctx, (const char*)ctx->ebx);
+
     uint32_t a1 = ctx->ebx;
     uint32_t a2 = ctx->ecx;
     uint32_t a3 = ctx->edx;
@@ -68,15 +81,33 @@ static int32_t sys_exit(int exit_code, uint32_t unused1, uint32_t unused2,
 }
 
 // fork - Yeni bir işlem oluştur
-static int32_t sys_fork(uint32_t unused1, uint32_t unused2, uint32_t unused3, 
-                       uint32_t unused4, uint32_t unused5, uint32_t unused6) {
-    (void)unused1; (void)unused2; (void)unused3; 
-    (void)unused4; (void)unused5; (void)unused6;
+static int32_t sys_fork(struct isr_context* ctx) {
+    // pushal kayıtlarının hemen üstünde CPU'nun iret çerçevesi durur:
+    // eip, cs, eflags ve (kullanıcıdan gelindiyse) esp, ss
+    uint32_t* frame = ctx ? (uint32_t*)(ctx + 1) : NULL;
+    if (!frame || (frame[1] & 3) != 3) return -1; // yalnızca kullanıcı modundan
     
+    // Adres alanı copy-on-write klonlanır: sayfa tabloları kopyalanır,
+    // sayfalar ilk yazmada sayfa hatası işleyicisinde kopyalanır
     process_t* child = process_create();
     if (!child) return -1;
     
-    // TODO: Çocuk işlemin bağlamını kopyala (COW vs.)
+    child->uc.eip = frame[0];
+    child->uc.cs = frame[1];
+    child->uc.eflags = frame[2];
+    child->uc.esp = frame[3];
+    child->uc.ss = frame[4];
+    child->uc.ds = child->uc.es = child->uc.fs = child->uc.gs = frame[4];
+    child->uc.eax = 0; // çocukta fork() 0 döner
+    child->uc.ebx = ctx->ebx;
+    child->uc.ecx = ctx->ecx;
+    child->uc.edx = ctx->edx;
+    child->uc.esi = ctx->esi;
+    child->uc.edi = ctx->edi;
+    child->uc.ebp = ctx->ebp;
+    
+    // Çocuk kendi iş parçacığında syscall dönüşünden devam eder
+    if (process_start(child) < 0) return -1;
     
     return child->pid; // Ebeveynde çocuğun PID'sini döndür
 }
@@ -92,25 +123,14 @@ static int32_t sys_read(int fd, void* buf, size_t count,
         char* out = (char*)buf;
         size_t n = 0;
         while (n < count) {
-            int ch = keyboard_getchar_nonblock();
-            if (ch < 0) {
-                // Try serial port as fallback (for -nographic/serial mode)
-                extern int serial_getchar_nonblock(void);
-                ch = serial_getchar_nonblock();
-                // Convert CR to LF for compatibility
-                if (ch == '\r') ch = '\n';
-            }
-            if (ch >= 0) {
-                out[n++] = (char)ch;
-                // Echo to VGA and serial so -nographic users see input
-                console_putc((char)ch);
-                char s[2] = { (char)ch, '\0' };
-                serial_write(s);
-                if (ch == '\n') break; // satır sonu okunduysa çık
-            } else {
-                // başka thread'lere CPU ver
-                thread_yield();
-            }
+            // Girdi gelene kadar uyu (klavye/seri kesmesi uyandırır)
+            int ch = console_getchar();
+            out[n++] = (char)ch;
+            // Echo to VGA and serial so -nographic users see input
+            console_putc((char)ch);
+            char echo = (char)ch;
+            serial_write_buf(&echo, 1);
+            if (ch == '\n') break; // satır sonu okunduysa çık
         }
         return (int32_t)n;
     }
@@ -125,14 +145,21 @@ static int32_t sys_write(int fd, const void* buf, size_t count,
     (void)unused1; (void)unused2; (void)unused3;
     
     if (fd == 1 || fd == 2) { // stdout veya stderr
-        // Konsola yaz ve ayrıca seri porta yansıt
+        // Konsola yaz ve ayrıca seri porta yansıt: ekrana satır satır toplu
+        // kopyalanır, seri port tek seferde kuyruğa alınır (IRQ4 gönderir).
+        // Kullanıcı belleği önce çekirdek tamponuna kopyalanır: ilk dokunuş
+        // sayfa hatasıyla diskten okuyabilir, bu konsol/seri kilitleri
+        // tutulurken olmamalı
+        if (!buf) return -1;
         const char* str = (const char*)buf;
-        for (size_t i = 0; i < count; i++) {
-            char ch = str[i];
-            if (ch == '\0') break;
-            console_putc(ch);
-            char tmp[2] = { ch, '\0' };
-            serial_write(tmp);
+        char bounce[SYS_WRITE_CHUNK];
+        for (size_t done = 0; done < count; ) {
+            size_t n = count - done;
+            if (n > sizeof(bounce)) n = sizeof(bounce);
+            memcpy(bounce, str + done, n);
+            console_write(bounce, n);
+            serial_write_buf(bounce, n);
+            done += n;
         }
         return (int32_t)count;
     }
@@ -155,11 +182,8 @@ static int32_t sys_close(int fd, uint32_t unused1, uint32_t unused2,
     return vfs_close(fd);
 }
 
-// execve - Program çalıştırma
-static int32_t sys_execve(const char* path, char* const argv[], char* const envp[],
-                         uint32_t unused1, uint32_t unused2, uint32_t unused3) {
-    (void)argv; (void)envp; (void)unused1; (void)unused2; (void)unused3;
-    
+// execve - Program çalıştırma (argv/envp henüz desteklenmiyor)
+static int32_t sys_execve(struct isr_context* ctx, const char* path) {
     process_t* current = process_current();
     if (!current) return -1;
     
@@ -168,7 +192,15 @@ static int32_t sys_execve(const char* path, char* const argv[], char* const envp
         return -1;
     }
     
-    return 0; // Buraya asla ulaşılmaz
+    // Eski adres alanı gitti: iret yeni programın girişine ve yığınına dönsün
+    uint32_t* frame = ctx ? (uint32_t*)(ctx + 1) : NULL;
+    if (frame && (frame[1] & 3) == 3) {
+        frame[0] = current->uc.eip;
+        frame[2] = current->uc.eflags;
+        frame[3] = current->uc.esp;
+        memset(ctx, 0, sizeof(*ctx));
+    }
+    return 0;
 }
 
 // getpid - Mevcut işlem kimliğini döndür
@@ -213,15 +245,86 @@ static int32_t sys_waitpid(pid_t pid, int* status, int options,
     return -1; // Şimdilik desteklenmiyor
 }
 
+// tid ile iş parçacığı bul (0: çağıran iş parçacığı). Liste kilidi tutularak
+// çağrılır; aksi halde iş parçacığı thread_join ile serbest bırakılabilir.
+static thread_t* find_thread(tid_t tid) {
+    if (tid == 0) return sched_current_thread();
+    for (thread_t* t = thread_list_head(); t; t = t->next) {
+        if (t->tid == tid) return t;
+    }
+    return NULL;
+}
+
+// setpriority - İş parçacığının öncelik seviyesini değiştir (0 en acil)
+static int32_t sys_setpriority(tid_t tid, int priority, uint32_t unused1,
+                              uint32_t unused2, uint32_t unused3, uint32_t unused4) {
+    (void)unused1; (void)unused2; (void)unused3; (void)unused4;
+    
+    uint32_t flags = thread_list_lock();
+    thread_t* t = find_thread(tid);
+    int ret = t ? sched_set_priority(t, priority) : -1;
+    thread_list_unlock(flags);
+    return ret;
+}
+
+// getpriority - İş parçacığının öncelik seviyesini döndür
+static int32_t sys_getpriority(tid_t tid, uint32_t unused1, uint32_t unused2,
+                              uint32_t unused3, uint32_t unused4, uint32_t unused5) {
+    (void)unused1; (void)unused2; (void)unused3; (void)unused4; (void)unused5;
+    
+    uint32_t flags = thread_list_lock();
+    thread_t* t = find_thread(tid);
+    int ret = t ? t->priority : -1;
+    thread_list_unlock(flags);
+    return ret;
+}
+
+// sched_stat - İş parçacığının çalışma/bekleme süreleri ve geçiş sayaçları,
+// istenirse genel uyanma gecikmesi histogramı (tid 0: çağıran)
+static int32_t sys_sched_stat(tid_t tid, sched_stat_t* out, uint32_t* hist, uint32_t buckets,
+                             uint32_t unused1, uint32_t unused2) {
+    (void)unused1; (void)unused2;
+    
+    if (out) {
+        // Kullanıcı belleğine kilit bırakıldıktan sonra yazılır
+        sched_stat_t st;
+        uint32_t flags = thread_list_lock();
+        thread_t* t = find_thread(tid);
+        if (t) sched_get_thread_stats(t, &st);
+        thread_list_unlock(flags);
+        if (!t) return -1;
+        *out = st;
+    }
+    if (hist) sched_get_latency_hist(hist, buckets);
+    return SCHED_LAT_BUCKETS;
+}
+
+// clock_gettime - Monoton saat (açılıştan beri, ns çözünürlükte)
+static int32_t sys_clock_gettime(clockid_t clock_id, struct timespec* ts, uint32_t unused1,
+                                uint32_t unused2, uint32_t unused3, uint32_t unused4) {
+    (void)unused1; (void)unused2; (void)unused3; (void)unused4;
+    
+    // Gerçek zaman saati yok: REALTIME de açılıştan beri sayar
+    if (!ts || (clock_id != CLOCK_MONOTONIC && clock_id != CLOCK_REALTIME)) return -1;
+    
+    uint32_t nsec;
+    uint64_t sec = ktime_div_u64(ktime_get_ns(), NSEC_PER_SEC, &nsec);
+    ts->tv_sec = (time_t)sec;
+    ts->tv_nsec = (long)nsec;
+    return 0;
+}
+
 // Syscall'ları başlat
 void syscalls_init(void) {
     // Temel işlem yönetimi
     syscall_register(SYS_EXIT, (syscall_handler_t)sys_exit);
-    syscall_register(SYS_FORK, (syscall_handler_t)sys_fork);
-    syscall_register(SYS_EXECVE, (syscall_handler_t)sys_execve);
+    // SYS_FORK ve SYS_EXECVE syscall_handler içinde bağlamla çağrılır
     syscall_register(SYS_WAITPID, (syscall_handler_t)sys_waitpid);
     syscall_register(SYS_GETPID, (syscall_handler_t)sys_getpid);
     syscall_register(SYS_GETPPID, (syscall_handler_t)sys_getppid);
+    syscall_register(SYS_GETPRIORITY, (syscall_handler_t)sys_getpriority);
+    syscall_register(SYS_SETPRIORITY, (syscall_handler_t)sys_setpriority);
+    syscall_register(SYS_SCHED_STAT, (syscall_handler_t)sys_sched_stat);
     
     // Dosya işlemleri
     syscall_register(SYS_READ, (syscall_handler_t)sys_read);
@@ -229,6 +332,9 @@ void syscalls_init(void) {
     syscall_register(SYS_OPEN, (syscall_handler_t)sys_open);
     syscall_register(SYS_CLOSE, (syscall_handler_t)sys_close);
     
+    // Zaman
+    syscall_register(SYS_CLOCK_GETTIME, (syscall_handler_t)sys_clock_gettime);
+    
     // Bellek yönetimi
     syscall_register(SYS_SBRK, (syscall_handler_t)sys_sbrk);
     
@@ -4,6 +4,7 @@
 #include <kernel/process.h>
 #include <kernel/timer.h>
 #include <kernel/console.h>
+#include <kernel/spinlock.h>
 #include <arch/x86/io.h>
 #include <string.h>
 
@@ -25,14 +26,17 @@ static void thread_entry(void);
 
 #define DEFAULT_STACK_SIZE (16 * 1024) // 16KB stack
 
+// Threads are created, joined and listed from every CPU; thread_lock
+// covers next_tid and the list links
+static spinlock_t thread_lock = SPINLOCK_INIT("threads");
 static tid_t next_tid = 1;
 static thread_t* thread_list = NULL;
-thread_t* current_thread = NULL;
 
 // Function declarations
 static void thread_entry(void);
 static void setup_thread_stack(thread_t* thread);
 tid_t thread_create(void* (*entry)(void*), void* arg);
+tid_t thread_create_in(struct process* process, void* (*entry)(void*), void* arg);
 void thread_exit(void* retval);
 int thread_join(tid_t tid, void** retval);
 void thread_yield(void);
@@ -42,6 +46,11 @@ void threading_init(void);
 
 // Thread entry point
 static void thread_entry(void) {
+    // Arrived through a context switch: drop the run queue lock, then
+    // enable the interrupts a preempting switch left disabled
+    sched_finish_switch();
+    ASM_VOLATILE("sti");
+    
     // Debug output
     extern void serial_write(const char* str);
     serial_write("[DEBUG] thread_entry called!\r\n");
@@ -84,8 +93,14 @@ static void setup_thread_stack(thread_t* thread) {
     thread->stack = stack_top;
 }
 
-// Create a new thread
+// Create a new thread in the caller's process
 tid_t thread_create(void* (*entry)(void*), void* arg) {
+    return thread_create_in(process_current(), entry, arg);
+}
+
+// Create a new thread that belongs to 'process' (its address space is
+// loaded whenever the thread is switched in)
+tid_t thread_create_in(struct process* process, void* (*entry)(void*), void* arg) {
     if (!entry) return -1;
     
     // Allocate thread structure
@@ -101,19 +116,39 @@ tid_t thread_create(void* (*entry)(void*), void* arg) {
     }
     
     // Initialize thread
-    thread->tid = next_tid++;
     thread->state = THREAD_READY;
     thread->entry = entry;
     thread->arg = arg;
     thread->retval = NULL;
-    thread->process = process_current();
+    thread->process = process;
+    thread->sleep_idx = -1;
+    thread->time_slice = rr_quantum;
+    thread->priority = THREAD_PRIO_DEFAULT;
+    thread->on_rq = 0;
+    thread->rq_next = NULL;
+    thread->rq_prev = NULL;
+    thread->cpu = -1;
+    thread->on_cpu = 0;
+    thread->runtime_cycles = 0;
+    thread->wait_cycles = 0;
+    thread->run_stamp = 0;
+    thread->ready_stamp = 0;
+    thread->nr_switches = 0;
+    thread->nr_voluntary = 0;
+    thread->nr_involuntary = 0;
+    thread->woken = 0;
+    thread->wq = NULL;
+    thread->wq_next = NULL;
     
     // Set up stack
     setup_thread_stack(thread);
     
-    // Add to thread list
+    // Number it and add to thread list
+    uint32_t flags = spin_lock_irqsave(&thread_lock);
+    thread->tid = next_tid++;
     thread->next = thread_list;
     thread_list = thread;
+    spin_unlock_irqrestore(&thread_lock, flags);
     
     // Add to scheduler
     sched_add_thread(thread);
@@ -121,13 +156,43 @@ tid_t thread_create(void* (*entry)(void*), void* arg) {
     return thread->tid;
 }
 
+// Create the idle thread of a secondary CPU. It starts out RUNNING on its
+// own stack (the CPU boots on it) and is never put on a ready queue.
+thread_t* thread_create_idle(void) {
+    thread_t* thread = (thread_t*)kmalloc(sizeof(thread_t));
+    if (!thread) return NULL;
+    memset(thread, 0, sizeof(thread_t));
+
+    thread->stack_size = DEFAULT_STACK_SIZE;
+    thread->stack_base = kmalloc(thread->stack_size);
+    if (!thread->stack_base) {
+        kfree(thread);
+        return NULL;
+    }
+
+    thread->state = THREAD_RUNNING;
+    thread->process = process_current();
+    thread->sleep_idx = -1;
+    thread->time_slice = rr_quantum;
+    thread->priority = THREAD_PRIO_LEVELS - 1;
+    thread->stack = (void*)(((uint32_t)thread->stack_base + thread->stack_size) & ~0xFu);
+
+    uint32_t flags = spin_lock_irqsave(&thread_lock);
+    thread->tid = next_tid++;
+    thread->next = thread_list;
+    thread_list = thread;
+    spin_unlock_irqrestore(&thread_lock, flags);
+    return thread;
+}
+
 // Exit current thread
 void thread_exit(void* retval) {
-    if (!current_thread) return;
+    thread_t* self = sched_current_thread();
+    if (!self) return;
     
     // Save return value
-    current_thread->retval = retval;
-    current_thread->state = THREAD_TERMINATED;
+    self->retval = retval;
+    self->state = THREAD_TERMINATED;
     
     // Schedule next thread
     thread_yield();
@@ -141,25 +206,19 @@ int thread_join(tid_t tid, void** retval) {
     if (tid <= 0) return -1;
     
     // Find the thread
+    uint32_t flags = spin_lock_irqsave(&thread_lock);
     thread_t* thread = thread_list;
-    thread_t* prev = NULL;
-    
-    while (thread) {
-        if (thread->tid == tid) {
-            break;
-        }
-        prev = thread;
-        thread = thread->next;
-    }
+    while (thread && thread->tid != tid) thread = thread->next;
+    spin_unlock_irqrestore(&thread_lock, flags);
     
     // Thread not found
     if (!thread) return -1;
     
     // Can't join self
-    if (thread == current_thread) return -1;
+    if (thread == sched_current_thread()) return -1;
     
-    // Wait until thread terminates
-    while (thread->state != THREAD_TERMINATED) {
+    // Wait until thread terminates and its CPU has switched off its stack
+    while (thread->state != THREAD_TERMINATED || thread->on_cpu) {
         thread_yield();
     }
     
@@ -168,12 +227,12 @@ int thread_join(tid_t tid, void** retval) {
         *retval = thread->retval;
     }
     
-    // Remove from thread list
-    if (prev) {
-        prev->next = thread->next;
-    } else {
-        thread_list = thread->next;
-    }
+    // Remove from thread list; it may have moved since the lookup
+    flags = spin_lock_irqsave(&thread_lock);
+    thread_t** link = &thread_list;
+    while (*link && *link != thread) link = &(*link)->next;
+    if (*link) *link = thread->next;
+    spin_unlock_irqrestore(&thread_lock, flags);
     
     // Free thread resources
     kfree(thread->stack_base);
@@ -184,12 +243,13 @@ int thread_join(tid_t tid, void** retval) {
 
 // Yield CPU to another thread
 void thread_yield(void) {
-    ASM_VOLATILE("int $0x20"); // Yield interrupt
+    sched_yield();
 }
 
 // Get current thread ID
 tid_t thread_self(void) {
-    return current_thread ? current_thread->tid : 0;
+    thread_t* self = sched_current_thread();
+    return self ? self->tid : 0;
 }
 
 // Sleep for milliseconds
@@ -199,15 +259,23 @@ void thread_sleep(uint32_t ms) {
         return;
     }
     
-    // Calculate wakeup time (assuming 1000 ticks per second)
-    uint32_t wakeup_time = timer_ticks + (ms * 1000) / TICKS_PER_SEC;
+    // Calculate wakeup time, rounding up to whole ticks
+    uint32_t ticks = (ms * TICKS_PER_SEC + 999) / 1000;
+    uint32_t wakeup_time = timer_ticks + ticks;
+    
+    // Before the scheduler runs there is nobody to switch to
+    thread_t* self = sched_current_thread();
+    if (!self) {
+        timer_wait(ticks);
+        return;
+    }
     
     // Set thread state to blocked
-    current_thread->state = THREAD_BLOCKED;
-    current_thread->wakeup_time = wakeup_time;
+    self->state = THREAD_BLOCKED;
+    self->wakeup_time = wakeup_time;
     
     // Add to sleep queue
-    sched_add_sleeping_thread(current_thread);
+    sched_add_sleeping_thread(self);
     
     // Yield CPU
     thread_yield();
@@ -216,32 +284,34 @@ void thread_sleep(uint32_t ms) {
 // Initialize threading system
 void threading_init(void) {
     // Create main thread
-    current_thread = (thread_t*)kmalloc(sizeof(thread_t));
-    if (!current_thread) {
+    thread_t* main_thread = (thread_t*)kmalloc(sizeof(thread_t));
+    if (!main_thread) {
         kernel_bsod("Failed to initialize main thread");
     }
     
     // Initialize main thread
-    memset(current_thread, 0, sizeof(thread_t));
-    current_thread->tid = next_tid++;
+    memset(main_thread, 0, sizeof(thread_t));
+    main_thread->tid = next_tid++;
     // Bootstrap thread represents the current kernel context; mark as RUNNING
-    current_thread->state = THREAD_RUNNING;
-    current_thread->process = process_current();
-    current_thread->time_slice = rr_quantum;
+    main_thread->state = THREAD_RUNNING;
+    main_thread->process = process_current();
+    main_thread->time_slice = rr_quantum;
+    main_thread->priority = THREAD_PRIO_DEFAULT;
+    main_thread->sleep_idx = -1;
     
     // Allocate stack for main thread
-    current_thread->stack_size = DEFAULT_STACK_SIZE;
-    current_thread->stack_base = kmalloc(current_thread->stack_size);
-    if (!current_thread->stack_base) {
-        kfree(current_thread);
+    main_thread->stack_size = DEFAULT_STACK_SIZE;
+    main_thread->stack_base = kmalloc(main_thread->stack_size);
+    if (!main_thread->stack_base) {
+        kfree(main_thread);
         kernel_bsod("Failed to allocate stack for main thread");
     }
     
     // Set up initial stack pointer
-    current_thread->stack = (void*)((uint8_t*)current_thread->stack_base + current_thread->stack_size - 16);
+    main_thread->stack = (void*)((uint8_t*)main_thread->stack_base + main_thread->stack_size - 16);
     
     // Add to thread list
-    thread_list = current_thread;
+    thread_list = main_thread;
     
     // Do NOT enqueue bootstrap thread into ready queue; scheduler will start
     // with the first real kernel/user thread created later.
@@ -250,3 +320,6 @@ void threading_init(void) {
 
 // Expose head of thread list for diagnostics
 thread_t* thread_list_head(void) { return thread_list; }
+
+uint32_t thread_list_lock(void) { return spin_lock_irqsave(&thread_lock); }
+void thread_list_unlock(uint32_t flags) { spin_unlock_irqrestore(&thread_lock, flags); }
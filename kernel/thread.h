@@ -14,6 +14,10 @@ typedef enum {
     THREAD_TERMINATED
 } thread_state_t;
 
+// Scheduling priorities: 0 is the most urgent level
+#define THREAD_PRIO_LEVELS  32
+#define THREAD_PRIO_DEFAULT 16
+
 // Thread control block
 typedef struct thread {
     tid_t tid;                  // Thread ID
@@ -26,13 +30,32 @@ typedef struct thread {
     void* retval;               // Return value
     struct process* process;    // Parent process
     struct thread* next;        // Next thread in list
-    struct thread* next_sleeping; // Next thread in sleeping list
+    int sleep_idx;              // Slot in the sleep heap, -1 when awake
     uint32_t wakeup_time;       // Time when thread should wake up
     int time_slice;             // Remaining time slice
+    int priority;               // Run queue level (0..THREAD_PRIO_LEVELS-1)
+    int on_rq;                  // Linked into a ready queue
+    struct thread* rq_next;     // Next thread at the same priority
+    struct thread* rq_prev;     // Previous thread at the same priority
+    int cpu;                    // Run queue it was last put on, -1 before
+    volatile int on_cpu;        // A CPU is executing on its stack
+    // Scheduler accounting (TSC cycles, see sched_get_thread_stats())
+    uint64_t runtime_cycles;    // Time spent on a CPU
+    uint64_t wait_cycles;       // Time spent runnable on a ready queue
+    uint64_t run_stamp;         // When it was last switched in
+    uint64_t ready_stamp;       // When it was last queued
+    uint32_t nr_switches;       // Times it was switched in
+    uint32_t nr_voluntary;      // Switched out because it blocked or exited
+    uint32_t nr_involuntary;    // Switched out while still runnable
+    int woken;                  // Queued by a wakeup; latency not yet sampled
+    struct wait_queue* wq;      // Wait queue it is blocked on, NULL if none
+    struct thread* wq_next;     // Next waiter on the same queue
 } thread_t;
 
 // Thread functions
 tid_t thread_create(void* (*entry)(void*), void* arg);
+tid_t thread_create_in(struct process* process, void* (*entry)(void*), void* arg);
+thread_t* thread_create_idle(void);
 void thread_exit(void* retval);
 int thread_join(tid_t tid, void** retval);
 void thread_yield(void);
@@ -46,7 +69,10 @@ void threading_init(void);
 extern int rr_quantum;
 
 // Introspection helper: return head of internal thread list
-// Used by diagnostics (e.g., ps command)
+// Used by diagnostics (e.g., ps command). Walk it with the list locked:
+// threads are added and joined concurrently on other CPUs.
 thread_t* thread_list_head(void);
+uint32_t thread_list_lock(void);
+void thread_list_unlock(uint32_t flags);
 
 #endif // _KERNEL_THREAD_H
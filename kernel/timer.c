@@ -1,4 +1,5 @@
 #include <kernel/timer.h>
+#include <kernel/ktime.h>
 #include <kernel/irq.h>
 #include <kernel/console.h>
 // No need for console_utils.h since we'll use console_puts
@@ -14,17 +15,94 @@ volatile uint32_t timer_ticks = 0;
 // Timer interrupt handler callback
 static void (*timer_callback)(void) = 0;
 
+#define PIT_BASE_HZ   1193180
+#define PIT_MAX_COUNT 0xFFFF
+
+static int pit_hz = TIMER_FREQ;
+
+// Tickless idle state
+static int tickless = 1;
+static volatile int oneshot_armed = 0;
+static uint32_t oneshot_counts = 0;  // Counts programmed for the pending one-shot
+static uint32_t frac_counts = 0;     // Elapsed counts not yet worth a whole tick
+static uint32_t avoided_ticks = 0;   // Ticks accounted without taking an IRQ
+static uint32_t idle_entries = 0;    // One-shot idle periods started
+static uint32_t idle_early = 0;      // ...of which ended by another interrupt
+
+static void pit_program(uint8_t command, uint32_t count) {
+    outb(0x43, command);
+    outb(0x40, count & 0xFF);
+    outb(0x40, (count >> 8) & 0xFF);
+}
+
+static void pit_periodic(void) {
+    pit_program(0x36, PIT_BASE_HZ / pit_hz);   // Channel 0, lobyte/hibyte, mode 3 (square wave)
+}
+
+static void pit_oneshot(uint32_t counts) {
+    pit_program(0x30, counts);                 // Channel 0, lobyte/hibyte, mode 0 (one-shot)
+}
+
+// Latch and read the channel 0 down-counter
+static uint32_t pit_read_count(void) {
+    outb(0x43, 0x00);
+    uint32_t lo = inb(0x40);
+    uint32_t hi = inb(0x40);
+    return lo | (hi << 8);
+}
+
+static timer_device_t pit_device = {
+    "pit", PIT_BASE_HZ / TIMER_FREQ, PIT_MAX_COUNT,
+    pit_periodic, pit_oneshot, pit_read_count
+};
+
+// Device that raises the tick; the PIT until something better registers
+static const timer_device_t* tick_dev = &pit_device;
+
 // Set the timer phase (implementation)
 void timer_phase(int hz) {
-    int divisor = 1193180 / hz;       // Calculate the divisor
-    outb(0x43, 0x36);                // Set command byte 0x36 (channel 0, lobyte/hibyte, mode 3, binary)
-    outb(0x40, divisor & 0xFF);      // Set low byte of divisor
-    outb(0x40, (divisor >> 8) & 0xFF); // Set high byte of divisor
+    pit_hz = hz;
+    pit_device.counts_per_tick = PIT_BASE_HZ / hz;   // Calculate the divisor
+    if (tick_dev == &pit_device) pit_periodic();
+}
+
+// Hand the tick over to another device (e.g. the local APIC timer). The
+// caller silences the old source; the new one starts ticking here.
+void timer_set_device(const timer_device_t* dev) {
+    uint32_t flags;
+    ASM_VOLATILE("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    oneshot_armed = 0;
+    frac_counts = 0;
+    tick_dev = dev ? dev : &pit_device;
+    tick_dev->periodic();
+    if (flags & 0x200) ASM_VOLATILE("sti");
+}
+
+const char* timer_device_name(void) {
+    return tick_dev->name;
+}
+
+// Turn the counts that elapsed during a one-shot into ticks.
+// 'fired' is set when the one-shot itself raised the interrupt.
+static void oneshot_account(uint32_t elapsed, int fired) {
+    frac_counts += elapsed;
+    uint32_t n = frac_counts / tick_dev->counts_per_tick;
+    frac_counts %= tick_dev->counts_per_tick;
+    timer_ticks += n;
+    if (n > (uint32_t)fired) avoided_ticks += n - fired;
 }
 
 // Timer interrupt handler
 void timer_handler(void) {
-    timer_ticks++;
+    if (oneshot_armed) {
+        // One-shot expired: credit the whole idle period, resume periodic ticks
+        oneshot_armed = 0;
+        oneshot_account(oneshot_counts, 1);
+        tick_dev->periodic();
+    } else {
+        timer_ticks++;
+    }
+    ktime_tick();
     
     // Call the registered callback if it exists
     if (timer_callback) {
@@ -32,6 +110,54 @@ void timer_handler(void) {
     }
 }
 
+// Halt until 'deadline' (in ticks) or the next interrupt. With tickless idle
+// the tick device is reprogrammed as a one-shot covering the whole wait (up
+// to what the device can count), so the periodic ticks in between are never
+// taken.
+void timer_idle_until(uint32_t deadline) {
+    ASM_VOLATILE("cli");
+    int32_t delta = (int32_t)(deadline - timer_ticks);
+    if (delta <= 0) {
+        ASM_VOLATILE("sti");
+        return;
+    }
+    if (!tickless || delta == 1) {
+        ASM_VOLATILE("sti; hlt");
+        return;
+    }
+    
+    uint32_t cpt = tick_dev->counts_per_tick;
+    uint32_t counts = (uint32_t)delta > tick_dev->max_counts / cpt
+                    ? tick_dev->max_counts : (uint32_t)delta * cpt;
+    oneshot_counts = counts;
+    oneshot_armed = 1;
+    idle_entries++;
+    tick_dev->oneshot(counts);
+    ASM_VOLATILE("sti; hlt; cli");
+    
+    if (oneshot_armed) {
+        // Woken by another interrupt: account for the part that elapsed
+        uint32_t left = tick_dev->remaining();
+        oneshot_armed = 0;
+        idle_early++;
+        oneshot_account(left < counts ? counts - left : counts, 0);
+        tick_dev->periodic();
+    }
+    ASM_VOLATILE("sti");
+}
+
+void timer_set_tickless(int on) {
+    tickless = (on != 0);
+}
+
+void timer_get_idle_stats(timer_idle_stats_t* out) {
+    if (!out) return;
+    out->tickless = tickless;
+    out->avoided_ticks = avoided_ticks;
+    out->idle_entries = idle_entries;
+    out->idle_early = idle_early;
+}
+
 // Initialize the timer with the specified frequency
 void timer_init(uint32_t frequency) {
     // Register the timer handler for IRQ0
@@ -52,9 +178,9 @@ uint32_t timer_get_ticks(void) {
 // Wait for the specified number of ticks
 void timer_wait(uint32_t ticks) {
     uint32_t eticks = timer_ticks + ticks;
-    while (timer_ticks < eticks) {
+    while ((int32_t)(eticks - timer_ticks) > 0) {
         // Wait for the tick count to reach the desired value
-        ASM_VOLATILE("hlt");
+        timer_idle_until(eticks);
     }
 }
 
@@ -67,8 +193,8 @@ void kernel_sleep(uint32_t ms) {
     }
 
     uint32_t end_ticks = timer_ticks + ticks;
-    while (timer_ticks < end_ticks) {
-        ASM_VOLATILE("hlt");
+    while ((int32_t)(end_ticks - timer_ticks) > 0) {
+        timer_idle_until(end_ticks);
     }
 }
 
@@ -5,6 +5,8 @@
 #include "include/kernel/console_utils.h"  // For console_printf
 #include "fs/fat32_vfs.h"
 #include "include/drivers/serial.h"
+#include "include/kernel/vm.h"
+#include "include/kernel/spinlock.h"
 #include <stddef.h>
 #include <string.h>
 #include <errno.h>
@@ -48,8 +50,10 @@ char* strtok_r(char* str, const char* delim, char** saveptr) {
 // Maximum number of open files
 #define MAX_OPEN_FILES 32
 
-// File descriptor table
+// File descriptor table. The lock covers claiming and releasing slots;
+// a slot is in use while its name is set.
 static vfs_node_t open_files[MAX_OPEN_FILES] = {0};
+static spinlock_t open_files_lock = SPINLOCK_INIT("vfs_fds");
 
 // Root filesystem
 static vfs_node_t vfs_root = {0};
@@ -381,6 +385,31 @@ ssize_t vfs_read(int fd, void* buf, size_t count) {
     return -EIO; // Shouldn't reach here
 }
 
+// Read from a node at an explicit offset without an open descriptor
+// (used by demand paging, which keeps its own copy of the node)
+ssize_t vfs_node_read(vfs_node_t* node, uint32_t offset, void* buf, size_t count) {
+    if (!node || !buf) {
+        return -EINVAL;
+    }
+    if (node->flags & FT_DIR) {
+        return -EISDIR;
+    }
+    if (offset >= node->size) {
+        return 0;
+    }
+    if (offset + count > node->size) {
+        count = node->size - offset;
+    }
+    if (node->read) {
+        return node->read(node, offset, buf, count);
+    }
+    if (node->data) {
+        memcpy(buf, (char*)node->data + offset, count);
+        return count;
+    }
+    return -EIO;
+}
+
 // Write data to a file
 ssize_t vfs_write(int fd, const void* buf, size_t count) {
     if (fd < 0 || fd >= MAX_OPEN_FILES || !open_files[fd].name[0]) {
@@ -403,6 +432,9 @@ ssize_t vfs_write(int fd, const void* buf, size_t count) {
         return -EBADF;
     }
     
+    // Cached executable pages of this file are about to go stale
+    vm_pcache_invalidate(node);
+    
     // If there's a write method, use it
     if (node->write) {
         ssize_t result = node->write(node, node->position, buf, count);
@@ -446,7 +478,7 @@ int vfs_open(const char* path, int flags) {
         return -EINVAL;
     }
     
-    // Find a free file descriptor
+    // Fail early when the table is full (the slot is claimed below)
     int fd = -1;
     for (int i = 0; i < MAX_OPEN_FILES; i++) {
         if (!open_files[i].name[0]) {
@@ -575,8 +607,23 @@ int vfs_open(const char* path, int flags) {
         }
     }
     
-    // Initialize the open file
-    open_files[fd] = node;
+    // Claim a slot now: the one found above may have been taken meanwhile
+    uint32_t lock_flags = spin_lock_irqsave(&open_files_lock);
+    fd = -1;
+    for (int i = 0; i < MAX_OPEN_FILES; i++) {
+        if (!open_files[i].name[0]) {
+            fd = i;
+            break;
+        }
+    }
+    if (fd != -1) {
+        // Initialize the open file
+        open_files[fd] = node;
+    }
+    spin_unlock_irqrestore(&open_files_lock, lock_flags);
+    if (fd == -1) {
+        return -EMFILE;
+    }
     
     // Set initial position
     if (flags & O_APPEND) {
@@ -589,7 +636,9 @@ int vfs_open(const char* path, int flags) {
     if (open_files[fd].open) {
         ret = open_files[fd].open(&open_files[fd], flags);
         if (ret != 0) {
+            uint32_t lock_flags = spin_lock_irqsave(&open_files_lock);
             open_files[fd] = (vfs_node_t){0};
+            spin_unlock_irqrestore(&open_files_lock, lock_flags);
             return ret;
         }
     }
@@ -610,7 +659,9 @@ int vfs_close(int fd) {
     }
     
     // Clear the file descriptor slot
+    uint32_t lock_flags = spin_lock_irqsave(&open_files_lock);
     open_files[fd] = (vfs_node_t){0};
+    spin_unlock_irqrestore(&open_files_lock, lock_flags);
     
     return ret;
 }
@@ -0,0 +1,381 @@
+#include "include/kernel/vm.h"
+#include "include/kernel/kheap.h"
+#include "include/memory/pmm.h"
+#include "include/arch/x86/paging.h"
+#include <kernel/spinlock.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define VM_PAGE_SIZE 0x1000u
+#define PF_PRESENT   0x1     // Hata kodu: koruma ihlali (sayfa mevcut)
+
+// Tüm adres alanlarının bölgeleri tek listede; hata anında sahibine göre süzülür.
+// Sayfa hataları her CPU'da gelebilir: bölge listesi, sayfa önbelleği ve
+// istatistikler vm_lock ile korunur. Kilit kısa tutulur: altında yalnızca
+// listeler değişir ve sayfa eşlenir (pmm); kmalloc/kfree ve dosya okuma
+// kilit dışında yapılır, böylece heap ve dosya sistemi kilitleri vm_lock
+// içine hiç girmez.
+static spinlock_t vm_lock = SPINLOCK_INIT("vm");
+static vm_region_t* regions = NULL;
+static vm_stats_t stats;
+
+// Salt okunur dosya sayfaları önbelleği: (dosya sistemi, inode, ofset) ->
+// çerçeve. Önbellek her çerçeve için bir PMM referansı tutar; sayfayı
+// eşleyen her süreç kendi referansını alır. Dolunca en eski girdi atılır.
+#define VM_PCACHE_BUCKETS 64
+#define VM_PCACHE_MAX     1024   // 4MB
+
+typedef struct vm_pcache_entry {
+    read_type_t fs;          // Dosya sistemini ayırt eder (inode'lar FS içinde tektir)
+    uint32_t inode;
+    uint32_t offset;         // Sayfa hizalı olmak zorunda değil: dosya ofseti
+    uint32_t frame;
+    struct vm_pcache_entry* hash_next;
+    struct vm_pcache_entry* age_next;
+} vm_pcache_entry_t;
+
+static vm_pcache_entry_t* pcache[VM_PCACHE_BUCKETS];
+static vm_pcache_entry_t* pcache_oldest = NULL;
+static vm_pcache_entry_t* pcache_newest = NULL;
+static uint32_t pcache_count = 0;
+
+// pcache_* yardımcıları vm_lock tutularak çağrılır
+static inline uint32_t pcache_hash(uint32_t inode, uint32_t offset) {
+    return ((inode * 2654435761u) ^ (offset >> 12)) % VM_PCACHE_BUCKETS;
+}
+
+static vm_pcache_entry_t* pcache_find(read_type_t fs, uint32_t inode, uint32_t offset) {
+    for (vm_pcache_entry_t* e = pcache[pcache_hash(inode, offset)]; e; e = e->hash_next) {
+        if (e->fs == fs && e->inode == inode && e->offset == offset) return e;
+    }
+    return NULL;
+}
+
+// Girdiyi tablolardan çıkar ve önbelleğin çerçeve referansını bırak;
+// girdinin belleğini çağıran kilidi bıraktıktan sonra kfree ile verir
+static void pcache_unlink(vm_pcache_entry_t* victim) {
+    vm_pcache_entry_t** link = &pcache[pcache_hash(victim->inode, victim->offset)];
+    while (*link != victim) link = &(*link)->hash_next;
+    *link = victim->hash_next;
+
+    vm_pcache_entry_t* prev = NULL;
+    for (vm_pcache_entry_t* e = pcache_oldest; e != victim; e = e->age_next) prev = e;
+    if (prev) prev->age_next = victim->age_next;
+    else pcache_oldest = victim->age_next;
+    if (pcache_newest == victim) pcache_newest = prev;
+
+    pmm_free_frame(victim->frame); // önbelleğin referansı
+    pcache_count--;
+}
+
+// Önceden ayrılmış 'e' girdisini ekle; yer açmak için atılan girdi (yoksa
+// NULL) döner ve kilit dışında serbest bırakılır
+static vm_pcache_entry_t* pcache_insert(vm_pcache_entry_t* e, read_type_t fs, uint32_t inode,
+                                        uint32_t offset, uint32_t frame) {
+    vm_pcache_entry_t* evicted = NULL;
+    if (pcache_count >= VM_PCACHE_MAX) {
+        evicted = pcache_oldest;
+        pcache_unlink(evicted);
+    }
+    e->fs = fs;
+    e->inode = inode;
+    e->offset = offset;
+    e->frame = frame;
+    pmm_frame_ref(frame);
+    uint32_t h = pcache_hash(inode, offset);
+    e->hash_next = pcache[h];
+    pcache[h] = e;
+    e->age_next = NULL;
+    if (pcache_newest) pcache_newest->age_next = e;
+    else pcache_oldest = e;
+    pcache_newest = e;
+    pcache_count++;
+    return evicted;
+}
+
+// Dosya yazıldığında önbellekteki sayfaları geçersiz kıl
+void vm_pcache_invalidate(const vfs_node_t* node) {
+    if (!node || !node->inode) return;
+    vm_pcache_entry_t* dead = NULL;
+    uint32_t flags = spin_lock_irqsave(&vm_lock);
+    vm_pcache_entry_t* e = pcache_oldest;
+    while (e) {
+        vm_pcache_entry_t* next = e->age_next;
+        if (e->fs == node->read && e->inode == node->inode) {
+            pcache_unlink(e);
+            e->hash_next = dead;
+            dead = e;
+        }
+        e = next;
+    }
+    spin_unlock_irqrestore(&vm_lock, flags);
+    while (dead) {
+        e = dead->hash_next;
+        kfree(dead);
+        dead = e;
+    }
+}
+
+vm_backing_t* vm_backing_open(const char* path) {
+    vm_backing_t* b = (vm_backing_t*)kmalloc(sizeof(vm_backing_t));
+    if (!b) return NULL;
+    if (vfs_lookup(path, &b->node) < 0) {
+        kfree(b);
+        return NULL;
+    }
+    b->refs = 1;
+    return b;
+}
+
+// Bölgeler süreçler arasında paylaşılabildiği için sayaç atomiktir
+void vm_backing_put(vm_backing_t* backing) {
+    if (backing && __sync_sub_and_fetch(&backing->refs, 1) == 0) kfree(backing);
+}
+
+// Bölgeyi doldur; listeye bağlamak çağırana kalır
+static void region_fill(vm_region_t* r, uint32_t* dir, uint32_t start, uint32_t end,
+                        uint32_t flags, vm_backing_t* backing, uint32_t file_start,
+                        uint32_t file_end, uint32_t file_off) {
+    r->dir = dir;
+    r->start = start;
+    r->end = end;
+    r->file_start = file_start;
+    r->file_end = backing ? file_end : file_start;
+    r->file_off = file_off;
+    r->flags = flags;
+    r->backing = backing;
+    if (backing) __sync_fetch_and_add(&backing->refs, 1);
+}
+
+// vm_lock tutularak çağrılır
+static void region_link(vm_region_t* r) {
+    r->next = regions;
+    regions = r;
+    stats.regions++;
+}
+
+// Kilit dışında serbest bırakılacak bölge zincirini ver
+static void region_free_list(vm_region_t* r) {
+    while (r) {
+        vm_region_t* next = r->next;
+        vm_backing_put(r->backing);
+        kfree(r);
+        r = next;
+    }
+}
+
+int vm_map_region(uint32_t* dir, uint32_t start, uint32_t end, uint32_t flags,
+                  vm_backing_t* backing, uint32_t file_start, uint32_t file_end,
+                  uint32_t file_off) {
+    start &= ~(VM_PAGE_SIZE - 1);
+    end = (end + VM_PAGE_SIZE - 1) & ~(VM_PAGE_SIZE - 1);
+    if (!dir || end <= start || end > KHEAP_START) return -1;
+
+    vm_region_t* r = (vm_region_t*)kmalloc(sizeof(vm_region_t));
+    if (!r) return -1;
+    region_fill(r, dir, start, end, flags, backing, file_start, file_end, file_off);
+    uint32_t irq = spin_lock_irqsave(&vm_lock);
+    region_link(r);
+    spin_unlock_irqrestore(&vm_lock, irq);
+    return 0;
+}
+
+// Kopyalar kilit dışında ayrılır. 'src' bölgelerini yalnızca sahibinin
+// iş parçacığı değiştirir (fork'u yapan), bu yüzden sayı iki geçiş arasında
+// değişmez; değiştiyse klonlama başarısız sayılır.
+int vm_clone_regions(uint32_t* src, uint32_t* dst) {
+    uint32_t count = 0;
+    uint32_t irq = spin_lock_irqsave(&vm_lock);
+    for (vm_region_t* r = regions; r; r = r->next) {
+        if (r->dir == src) count++;
+    }
+    spin_unlock_irqrestore(&vm_lock, irq);
+
+    vm_region_t* spare = NULL;
+    for (uint32_t i = 0; i < count; i++) {
+        vm_region_t* r = (vm_region_t*)kmalloc(sizeof(vm_region_t));
+        if (!r) {
+            region_free_list(spare);
+            return -1;
+        }
+        r->backing = NULL;
+        r->next = spare;
+        spare = r;
+    }
+
+    int ret = 0;
+    irq = spin_lock_irqsave(&vm_lock);
+    // Yeni bölgeler listenin başına eklenir, yürüyüşü etkilemez
+    for (vm_region_t* r = regions; r; r = r->next) {
+        if (r->dir != src) continue;
+        if (!spare) {
+            ret = -1;
+            break;
+        }
+        vm_region_t* copy = spare;
+        spare = spare->next;
+        region_fill(copy, dst, r->start, r->end, r->flags, r->backing,
+                    r->file_start, r->file_end, r->file_off);
+        region_link(copy);
+    }
+    spin_unlock_irqrestore(&vm_lock, irq);
+    region_free_list(spare);
+    return ret;
+}
+
+void vm_unmap_all(uint32_t* dir) {
+    vm_region_t* dead = NULL;
+    uint32_t irq = spin_lock_irqsave(&vm_lock);
+    vm_region_t** link = &regions;
+    while (*link) {
+        vm_region_t* r = *link;
+        if (r->dir == dir) {
+            *link = r->next;
+            r->next = dead;
+            dead = r;
+            stats.regions--;
+        } else {
+            link = &r->next;
+        }
+    }
+    spin_unlock_irqrestore(&vm_lock, irq);
+    region_free_list(dead);
+}
+
+// Bir sayfaya dosyadan okunacak parça; komşu segmentler aynı sayfayı
+// paylaşabildiği için birden fazla olabilir
+#define VM_FAULT_READS 4
+
+typedef struct {
+    vm_backing_t* backing;   // Okuma bitene kadar referans tutulur
+    uint32_t file_off;
+    uint32_t lo, hi;         // Sayfa içindeki sanal aralık
+} vm_fault_read_t;
+
+// Mevcut olmayan sayfaya erişim: sayfayı kapsayan tüm bölgelerden doldur.
+// Üç adım: kilit altında bölgeler ve önbellek aranır; kilit bırakılıp
+// çerçeve ayrılır ve dosya okunur; kilit yeniden alınıp sayfa önbelleğe
+// eklenir. Arada başka bir CPU aynı dosya sayfasını önbelleğe koyduysa
+// onun çerçevesi kullanılır, bizimki geri verilir.
+int vm_handle_fault(uint32_t addr, uint32_t error_code) {
+    if (error_code & PF_PRESENT) return -1;
+
+    uint32_t* dir = paging_current_directory();
+    uint32_t page = addr & ~(VM_PAGE_SIZE - 1);
+    int found = 0, writable = 0, nreads = 0;
+    vm_fault_read_t reads[VM_FAULT_READS];
+
+    uint32_t irq = spin_lock_irqsave(&vm_lock);
+    for (vm_region_t* r = regions; r; r = r->next) {
+        if (r->dir == dir && page >= r->start && page < r->end) {
+            found = 1;
+            if (r->flags & VM_WRITE) writable = 1;
+        }
+    }
+    if (!found) {
+        spin_unlock_irqrestore(&vm_lock, irq);
+        return -1;
+    }
+
+    // Tek bir salt okunur bölgenin tamamen dosyadan gelen sayfası önbelleğe
+    // uygun: her süreç aynı çerçeveyi salt okunur eşler, veri kopyalanmaz
+    vm_region_t* text = NULL;
+    for (vm_region_t* r = regions; r; r = r->next) {
+        if (r->dir != dir || page + VM_PAGE_SIZE <= r->start || page >= r->end) continue;
+        if (text || (r->flags & VM_WRITE) || !r->backing || !r->backing->node.inode ||
+            page < r->file_start || page + VM_PAGE_SIZE > r->file_end) {
+            text = NULL;
+            break;
+        }
+        text = r;
+    }
+    read_type_t fs = text ? text->backing->node.read : NULL;
+    uint32_t inode = text ? text->backing->node.inode : 0;
+    uint32_t offset = text ? text->file_off + (page - text->file_start) : 0;
+    if (text) {
+        vm_pcache_entry_t* e = pcache_find(fs, inode, offset);
+        if (e) {
+            int ret = paging_map_page_flags(page, e->frame, PAGING_USER);
+            if (ret == 0) {
+                pmm_frame_ref(e->frame);
+                stats.faults++;
+                stats.cache_hits++;
+            }
+            spin_unlock_irqrestore(&vm_lock, irq);
+            return ret;
+        }
+    }
+
+    // Okunacak parçalar; dosyalar okuma bitene kadar referansla tutulur
+    for (vm_region_t* r = regions; r; r = r->next) {
+        if (r->dir != dir || !r->backing || page < r->start || page >= r->end) continue;
+        uint32_t lo = page > r->file_start ? page : r->file_start;
+        uint32_t hi = page + VM_PAGE_SIZE < r->file_end ? page + VM_PAGE_SIZE : r->file_end;
+        if (lo >= hi) continue;
+        if (nreads == VM_FAULT_READS) {
+            found = 0;
+            break;
+        }
+        __sync_fetch_and_add(&r->backing->refs, 1);
+        reads[nreads].backing = r->backing;
+        reads[nreads].file_off = r->file_off + (lo - r->file_start);
+        reads[nreads].lo = lo;
+        reads[nreads].hi = hi;
+        nreads++;
+    }
+    spin_unlock_irqrestore(&vm_lock, irq);
+
+    // Kilit dışında: çerçeve, önbellek girdisi ve dosya okuması
+    uint32_t frame = found ? pmm_alloc_frame() : 0;
+    if (frame && paging_map_page_flags(page, frame, PAGING_RW | PAGING_USER) < 0) {
+        pmm_free_frame(frame);
+        frame = 0;
+    }
+    if (frame) {
+        memset((void*)page, 0, VM_PAGE_SIZE);
+        for (int i = 0; i < nreads; i++) {
+            vfs_node_read(&reads[i].backing->node, reads[i].file_off,
+                          (void*)reads[i].lo, reads[i].hi - reads[i].lo);
+        }
+        // Salt okunur bölgelerde yazma iznini doldurduktan sonra kaldır
+        if (!writable) paging_map_page_flags(page, frame, PAGING_USER);
+    }
+    for (int i = 0; i < nreads; i++) vm_backing_put(reads[i].backing);
+    if (!frame) return -1;
+
+    vm_pcache_entry_t* entry = text ? (vm_pcache_entry_t*)kmalloc(sizeof(vm_pcache_entry_t)) : NULL;
+    vm_pcache_entry_t* unused = NULL;
+    uint32_t spare_frame = 0;
+
+    irq = spin_lock_irqsave(&vm_lock);
+    if (entry) {
+        vm_pcache_entry_t* e = pcache_find(fs, inode, offset);
+        if (e && paging_map_page_flags(page, e->frame, PAGING_USER) == 0) {
+            // Başka bir CPU daha önce doldurdu: onun çerçevesini paylaş
+            pmm_frame_ref(e->frame);
+            spare_frame = frame;
+            unused = entry;
+        } else if (!e) {
+            unused = pcache_insert(entry, fs, inode, offset, frame);
+        } else {
+            unused = entry;
+        }
+    }
+    stats.faults++;
+    if (nreads) stats.file_pages++;
+    else stats.zero_pages++;
+    spin_unlock_irqrestore(&vm_lock, irq);
+
+    if (spare_frame) pmm_free_frame(spare_frame);
+    if (unused) kfree(unused);
+    return 0;
+}
+
+void vm_get_stats(vm_stats_t* out) {
+    if (!out) return;
+    uint32_t irq = spin_lock_irqsave(&vm_lock);
+    *out = stats;
+    out->cached_pages = pcache_count;
+    spin_unlock_irqrestore(&vm_lock, irq);
+}
@@ -0,0 +1,83 @@
+#include <kernel/wait.h>
+#include <kernel/sched.h>
+#include <kernel/thread.h>
+
+void wait_queue_init(wait_queue_t* wq, const char* name) {
+    spin_init(&wq->lock, name);
+    wq->head = wq->tail = NULL;
+}
+
+static void wq_append(wait_queue_t* wq, thread_t* t) {
+    t->wq = wq;
+    t->wq_next = NULL;
+    if (wq->tail) wq->tail->wq_next = t;
+    else wq->head = t;
+    wq->tail = t;
+}
+
+static void wq_unlink(wait_queue_t* wq, thread_t* t) {
+    thread_t* prev = NULL;
+    for (thread_t* cur = wq->head; cur; prev = cur, cur = cur->wq_next) {
+        if (cur != t) continue;
+        if (prev) prev->wq_next = t->wq_next;
+        else wq->head = t->wq_next;
+        if (wq->tail == t) wq->tail = prev;
+        break;
+    }
+    t->wq = NULL;
+    t->wq_next = NULL;
+}
+
+// Queue the current thread and mark it blocked. It keeps running until
+// wait_schedule(), so the caller can still test its condition; a wakeup
+// in between just makes it READY again and the switch is skipped.
+void wait_prepare(wait_queue_t* wq) {
+    thread_t* self = sched_current_thread();
+    if (!self) return;
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    if (self->wq != wq) wq_append(wq, self);
+    self->state = THREAD_BLOCKED;
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+// Give up the CPU until woken. Before the scheduler runs there is no
+// thread to block, so just halt until the next interrupt.
+void wait_schedule(void) {
+    if (sched_current_thread()) sched_yield();
+    else __asm__ __volatile__("sti; hlt");
+}
+
+// Back to running: leave the queue if nobody woke us, or take ourselves
+// off the ready queue if a wakeup came in before we could block
+void wait_finish(wait_queue_t* wq) {
+    thread_t* self = sched_current_thread();
+    if (!self) return;
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    if (self->wq == wq) wq_unlink(wq, self);
+    else if (self->on_rq) sched_remove_thread(self);
+    self->state = THREAD_RUNNING;
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+// Waking under the queue lock: wait_finish() then sees either a queued
+// thread or one that is fully on a ready queue, never something in between
+static int wake_up(wait_queue_t* wq, int max) {
+    int woken = 0;
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    while (wq->head && (max < 0 || woken < max)) {
+        thread_t* t = wq->head;
+        wq_unlink(wq, t);
+        sched_wake_thread(t);
+        woken++;
+    }
+    spin_unlock_irqrestore(&wq->lock, flags);
+    return woken;
+}
+
+int wake_up_one(wait_queue_t* wq) {
+    return wake_up(wq, 1);
+}
+
+int wake_up_all(wait_queue_t* wq) {
+    return wake_up(wq, -1);
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <stdint.h>
+#include <kernel/schedstat.h>
+
+// Userspace wrapper for the scheduler statistics syscall. tid 0 is the
+// caller. Either pointer may be NULL; 'hist' receives up to 'buckets'
+// entries of the global wakeup latency histogram.
+int sched_stat(uint32_t tid, sched_stat_t* out, uint32_t* hist, uint32_t buckets);
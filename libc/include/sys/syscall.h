@@ -16,10 +16,14 @@ typedef enum {
     SYS_GETPID,
     SYS_GETPPID,
     SYS_SBRK,
+    SYS_GETPRIORITY = 54,
+    SYS_SETPRIORITY = 55,
+    SYS_CLOCK_GETTIME = 71,
     // --- RetaOS custom extensions (must match kernel values) ---
     SYS_FB_GETINFO = 240,
     SYS_FB_FILL    = 241,
     SYS_FB_RECT    = 242,
+    SYS_SCHED_STAT = 243,
     // Diğer syscall'lar...
 } syscall_num_t;
 
@@ -0,0 +1,6 @@
+#include <retaos/sched.h>
+#include <sys/syscall.h>
+
+int sched_stat(uint32_t tid, sched_stat_t* out, uint32_t* hist, uint32_t buckets) {
+    return SYSCALL4(SYS_SCHED_STAT, tid, (long)out, (long)hist, buckets);
+}
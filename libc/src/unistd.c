@@ -2,6 +2,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <sys/syscall.h>
+#include <time.h>
 
 // System call wrapper
 static long _syscall1(long n, long a1) {
@@ -100,3 +101,7 @@ int chdir(const char *path) {
     return _syscall1(SYS_CHDIR, (long)path);
 }
 #endif
+
+int clock_gettime(clockid_t clock_id, struct timespec *tp) {
+    return _syscall3(SYS_CLOCK_GETTIME, clock_id, (long)tp, 0);
+}
@@ -1,78 +1,147 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "include/drivers/serial.h"
-#include "include/multiboot.h"
 #include "include/arch/x86/multiboot2.h"
 #include "include/memory/pmm.h"
+#include "include/kernel/pmm.h"
+#include "include/kernel/spinlock.h"
 
 #define FRAME_SIZE 4096u
-#define MAX_PHYS_MEM_BYTES (128u*1024u*1024u)
-#define MAX_FRAMES (MAX_PHYS_MEM_BYTES / FRAME_SIZE)
+// Bitmap covers the whole 32-bit physical address space (no PAE)
+#define MAX_FRAMES (0x100000000ull / FRAME_SIZE)
 
-static uint32_t total_frames = MAX_FRAMES;
-static uint32_t used_frames = 0;
-static uint32_t highest_frame_index = 0;
-static uint32_t bitmap[(MAX_FRAMES + 31) / 32];
+static uint32_t total_frames = 0;
 
-static inline void set_frame(uint32_t frame_index){ bitmap[frame_index >> 5] |= (1u << (frame_index & 31)); }
-static inline void clear_frame(uint32_t frame_index){ bitmap[frame_index >> 5] &= ~(1u << (frame_index & 31)); }
+// Guards the bitmap, summary, refcounts and zone counters. A ticket lock:
+// every CPU allocates frames, and page faults must not starve behind it.
+static ticketlock_t pmm_lock = TICKETLOCK_INIT("pmm");
+#define BITMAP_WORDS ((MAX_FRAMES + 31) / 32)
+#define SUMMARY_WORDS ((BITMAP_WORDS + 31) / 32)
+
+static uint32_t bitmap[BITMAP_WORDS];
+// Second level: bit w set when bitmap[w] is completely used
+static uint32_t summary[SUMMARY_WORDS];
+
+// Per-frame reference counts for frames shared between address spaces
+// (copy-on-write). 0 = not handed out by the allocator (free or reserved).
+// A count that reaches PMM_REF_MAX sticks there and the frame is never freed.
+#define PMM_REF_MAX 0xFFu
+static uint8_t refcount[MAX_FRAMES];
+
+// Zones: DMA (<16MB, ISA DMA reachable), NORMAL (<896MB), HIGH (rest)
+static pmm_zone_t zones[PMM_ZONE_COUNT] = {
+    { "DMA",    0,                            PMM_DMA_LIMIT / FRAME_SIZE,    0, 0, 0 },
+    { "Normal", PMM_DMA_LIMIT / FRAME_SIZE,   PMM_NORMAL_LIMIT / FRAME_SIZE, 0, 0, 0 },
+    { "High",   PMM_NORMAL_LIMIT / FRAME_SIZE, (uint32_t)MAX_FRAMES,         0, 0, 0 },
+};
+
+static inline pmm_zone_t* zone_of(uint32_t frame_index){
+    if (frame_index < zones[PMM_ZONE_NORMAL].start_frame) return &zones[PMM_ZONE_DMA];
+    if (frame_index < zones[PMM_ZONE_HIGH].start_frame) return &zones[PMM_ZONE_NORMAL];
+    return &zones[PMM_ZONE_HIGH];
+}
+
+// set_frame/clear_frame are the only places that flip bitmap bits, so the
+// per-zone free counters stay exact at O(1) cost per frame
+static inline void set_frame(uint32_t frame_index){
+    uint32_t w = frame_index >> 5;
+    bitmap[w] |= (1u << (frame_index & 31));
+    if (bitmap[w] == 0xFFFFFFFFu) summary[w >> 5] |= (1u << (w & 31));
+    zone_of(frame_index)->free_frames--;
+}
+static inline void clear_frame(uint32_t frame_index){
+    uint32_t w = frame_index >> 5;
+    bitmap[w] &= ~(1u << (frame_index & 31));
+    summary[w >> 5] &= ~(1u << (w & 31));
+    zone_of(frame_index)->free_frames++;
+}
 static inline int test_frame(uint32_t frame_index){ return bitmap[frame_index >> 5] & (1u << (frame_index & 31)); }
 
+static void bitmap_fill_used(void){
+    for (size_t i = 0; i < BITMAP_WORDS; ++i) bitmap[i] = 0xFFFFFFFFu;
+    for (size_t i = 0; i < SUMMARY_WORDS; ++i) summary[i] = 0xFFFFFFFFu;
+    for (int z = 0; z < PMM_ZONE_COUNT; ++z){ zones[z].present_frames = zones[z].free_frames = 0; zones[z].hint = zones[z].start_frame >> 5; }
+    total_frames = 0;
+}
+
+// Called once the firmware-reported RAM has been marked free: whatever is
+// free now is the RAM each zone manages
+static void zones_snapshot_present(void){
+    for (int z = 0; z < PMM_ZONE_COUNT; ++z) zones[z].present_frames = zones[z].free_frames;
+}
+
+// Mark [start_frame, end_frame) as usable RAM
+static void release_range(uint32_t start_frame, uint32_t end_frame){
+    if (end_frame > MAX_FRAMES) end_frame = (uint32_t)MAX_FRAMES;
+    for (uint32_t f = start_frame; f < end_frame; ++f){
+        if (test_frame(f)) clear_frame(f);
+    }
+    if (end_frame > total_frames) total_frames = end_frame;
+}
+
 static void reserve_range(uint32_t start_addr, uint32_t end_addr){
     if (end_addr <= start_addr) return;
     uint32_t start_frame = start_addr / FRAME_SIZE;
     uint32_t end_frame = (end_addr + FRAME_SIZE - 1) / FRAME_SIZE;
     for (uint32_t f = start_frame; f < end_frame; ++f){
-        if (!test_frame(f)) { set_frame(f); used_frames++; }
+        if (!test_frame(f)) set_frame(f);
+    }
+}
+
+// Find a bitmap word with a free frame in words [lo, hi), via the summary
+static int scan_words(uint32_t lo, uint32_t hi, uint32_t* out_word){
+    while (lo < hi){
+        uint32_t sw = lo >> 5;
+        uint32_t avail = ~summary[sw] & (0xFFFFFFFFu << (lo & 31));
+        if (hi < ((sw + 1) << 5)) avail &= (1u << (hi & 31)) - 1;
+        if (avail){
+            *out_word = (sw << 5) + (uint32_t)__builtin_ctz(avail);
+            return 1;
+        }
+        lo = (sw + 1) << 5;
     }
+    return 0;
 }
 
-// Initialize PMM with memory map information
-void pmm_init(uint32_t mem_upper_kb, uint32_t kernel_start, uint32_t kernel_end, struct multiboot_info* mbi) {
-    // Clear bitmap: mark all as used initially
-    for (size_t i = 0; i < (sizeof(bitmap)/sizeof(bitmap[0])); ++i) bitmap[i] = 0xFFFFFFFFu;
-
-    // Determine highest available frame via mmap
-    highest_frame_index = 0;
-    if (mbi->flags & (1 << 6)) { // Check if memory map is valid
-        struct multiboot_tag *tag = (struct multiboot_tag *) (mbi + 1); // Start after the multiboot_info struct
-        while (tag->type != 0) { // End tag
-            if (tag->type == 6) { // Memory map tag
-                struct multiboot_tag_mmap *mmap_tag = (struct multiboot_tag_mmap *) tag;
-                struct multiboot_mmap_entry *entry = mmap_tag->entries;
-                uint32_t entry_count = (mmap_tag->size - sizeof(struct multiboot_tag_mmap)) / mmap_tag->entry_size;
-
-                for (uint32_t i = 0; i < entry_count; i++) {
-                    if (entry[i].type == 1) { // Available
-                        uint64_t region_end = entry[i].addr + entry[i].len;
-                        uint32_t region_end32 = (region_end > 0xFFFFFFFFu) ? 0xFFFFFFFFu : (uint32_t)region_end;
-                        uint32_t region_start32 = (entry[i].addr > 0xFFFFFFFFu) ? 0xFFFFFFFFu : (uint32_t)entry[i].addr;
-                        if (region_end32 > region_start32) {
-                            uint32_t end_frame = region_end32 / FRAME_SIZE;
-                            if (end_frame > highest_frame_index) highest_frame_index = end_frame;
-                            // Mark these frames free
-                            uint32_t start_frame = region_start32 / FRAME_SIZE;
-                            for (uint32_t f = start_frame; f < end_frame; ++f) {
-                                clear_frame(f);
-                            }
-                        }
-                    }
-                }
-                break; // Only process the first memory map tag
-            }
-            tag = (struct multiboot_tag *) ((uint8_t *) tag + ((tag->size + 7) & ~7)); // Align to 8 bytes
+// Next-fit inside one zone: from its rotating cursor to the end, then wrap
+static uint32_t zone_alloc_frame(pmm_zone_t* z){
+    if (!z->free_frames) return 0;
+    uint32_t end = z->end_frame < total_frames ? z->end_frame : total_frames;
+    uint32_t lo = z->start_frame >> 5, hi = (end + 31) >> 5, w;
+    uint32_t hint = (z->hint >= lo && z->hint < hi) ? z->hint : lo;
+    if (!scan_words(hint, hi, &w) && !scan_words(lo, hint, &w)) return 0;
+    uint32_t f = (w << 5) + (uint32_t)__builtin_ctz(~bitmap[w]);
+    if (f >= end) return 0;
+    set_frame(f);
+    refcount[f] = 1;
+    z->hint = w;
+    return f * FRAME_SIZE;
+}
+
+// Initialize PMM from the multiboot2 memory map
+void pmm_init(uint32_t mem_upper_kb, uint32_t kernel_start, uint32_t kernel_end,
+              const struct multiboot_mmap_entry* mmap, uint32_t mmap_count) {
+    // Mark everything used, then free what the firmware reports as RAM
+    bitmap_fill_used();
+
+    if (mmap && mmap_count){
+        for (uint32_t i = 0; i < mmap_count; i++) {
+            if (mmap[i].type != MULTIBOOT_MEMORY_AVAILABLE) continue;
+            uint64_t start = mmap[i].addr;
+            uint64_t end = mmap[i].addr + mmap[i].len;
+            if (start >= 0x100000000ull) continue;
+            if (end > 0x100000000ull) end = 0x100000000ull;
+            // Only whole frames inside the region are usable
+            uint32_t start_frame = (uint32_t)((start + FRAME_SIZE - 1) / FRAME_SIZE);
+            uint32_t end_frame = (uint32_t)(end / FRAME_SIZE);
+            if (end_frame > start_frame) release_range(start_frame, end_frame);
         }
     } else {
         // Fallback using mem_upper (in KB above 1MB)
-        uint32_t total_kb = 1024 + mem_upper_kb;
-        uint32_t total_bytes = total_kb * 1024u;
-        highest_frame_index = (total_bytes / FRAME_SIZE);
-        // Mark frames [0, highest_frame_index) free
-        for (uint32_t f = 0; f < highest_frame_index && f < MAX_FRAMES; ++f) clear_frame(f);
+        uint64_t total_bytes = (1024ull + mem_upper_kb) * 1024ull;
+        release_range(0, (uint32_t)(total_bytes / FRAME_SIZE));
     }
-
-    if (highest_frame_index > MAX_FRAMES) highest_frame_index = MAX_FRAMES;
-    total_frames = highest_frame_index;
+    zones_snapshot_present();
 
     // Reserve low memory (first 1MB)
     reserve_range(0, 0x100000u);
@@ -82,22 +151,7 @@ void pmm_init(uint32_t mem_upper_kb, uint32_t kernel_start, uint32_t kernel_end,
 
 // Basic PMM initialization without memory map
 void pmm_init_basic(uint32_t mem_upper_kb, uint32_t kernel_start, uint32_t kernel_end) {
-    // Clear bitmap: mark all as used initially
-    for (size_t i = 0; i < (sizeof(bitmap)/sizeof(bitmap[0])); ++i) bitmap[i] = 0xFFFFFFFFu;
-    
-    // Calculate total memory
-    uint32_t total_mem_kb = 1024 + mem_upper_kb; // First MB + extended memory
-    uint32_t total_frames = (total_mem_kb * 1024) / FRAME_SIZE;
-    if (total_frames > MAX_FRAMES) total_frames = MAX_FRAMES;
-    
-    // Mark all frames as free initially
-    for (uint32_t i = 0; i < total_frames; i++) {
-        clear_frame(i);
-    }
-    
-    // Mark kernel memory as used
-    pmm_mark_used_region(0, 0x100000); // First 1MB
-    pmm_mark_used_region(kernel_start, kernel_end - kernel_start);
+    pmm_init(mem_upper_kb, kernel_start, kernel_end, NULL, 0);
 }
 
 // Default PMM initialization with fixed memory size
@@ -112,32 +166,198 @@ void pmm_init_default(uint32_t mem_upper_kb) {
 // Mark a region of memory as used
 void pmm_mark_used_region(uint32_t base, uint32_t size) {
     if (size == 0) return;
-    uint32_t start_frame = base / FRAME_SIZE;
-    uint32_t end_frame = (base + size + FRAME_SIZE - 1) / FRAME_SIZE;
-    
-    for (uint32_t i = start_frame; i < end_frame; i++) {
-        if (!test_frame(i)) {
-            set_frame(i);
-            used_frames++;
-        }
-    }
+    uint32_t flags = ticket_lock_irqsave(&pmm_lock);
+    reserve_range(base, base + size);
+    ticket_unlock_irqrestore(&pmm_lock, flags);
 }
 
+// Prefer Normal, then High, and touch the DMA zone only as a last resort
 uint32_t pmm_alloc_frame(void){
-    for (uint32_t f = 0; f < total_frames; ++f){
-        if (!test_frame(f)){
-            set_frame(f);
-            used_frames++;
-            return f * FRAME_SIZE;
-        }
+    uint32_t flags = ticket_lock_irqsave(&pmm_lock);
+    uint32_t addr = zone_alloc_frame(&zones[PMM_ZONE_NORMAL]);
+    if (!addr) addr = zone_alloc_frame(&zones[PMM_ZONE_HIGH]);
+    if (!addr) addr = zone_alloc_frame(&zones[PMM_ZONE_DMA]);
+    ticket_unlock_irqrestore(&pmm_lock, flags);
+    return addr; // 0 = out of memory
+}
+
+uint32_t pmm_alloc_frame_zone(int zone){
+    if (zone < 0 || zone >= PMM_ZONE_COUNT) return 0;
+    uint32_t flags = ticket_lock_irqsave(&pmm_lock);
+    uint32_t addr = zone_alloc_frame(&zones[zone]);
+    ticket_unlock_irqrestore(&pmm_lock, flags);
+    return addr;
+}
+
+// Drop one reference; the frame goes back to the bitmap with the last one.
+// Frames reserved at init time carry no count and are freed directly.
+static void put_frame(uint32_t f){
+    if (f >= total_frames || !test_frame(f)) return;
+    if (refcount[f] == PMM_REF_MAX) return;
+    if (refcount[f] > 1){
+        refcount[f]--;
+        return;
     }
-    return 0; // out of memory
+    refcount[f] = 0;
+    clear_frame(f);
 }
 
 void pmm_free_frame(uint32_t frame_addr){
+    uint32_t flags = ticket_lock_irqsave(&pmm_lock);
+    put_frame(frame_addr / FRAME_SIZE);
+    ticket_unlock_irqrestore(&pmm_lock, flags);
+}
+
+// Take an extra reference on an allocated frame (e.g. when it becomes
+// shared copy-on-write); returns the new count, 0 if the frame is not in use
+uint32_t pmm_frame_ref(uint32_t frame_addr){
     uint32_t f = frame_addr / FRAME_SIZE;
-    if (f < total_frames && test_frame(f)){
-        clear_frame(f);
-        used_frames--;
+    if (f >= total_frames) return 0;
+    uint32_t flags = ticket_lock_irqsave(&pmm_lock);
+    uint32_t count = 0;
+    if (test_frame(f)){
+        if (refcount[f] < PMM_REF_MAX) refcount[f]++;
+        count = refcount[f];
     }
-} 
\ No newline at end of file
+    ticket_unlock_irqrestore(&pmm_lock, flags);
+    return count;
+}
+
+uint32_t pmm_frame_refcount(uint32_t frame_addr){
+    uint32_t f = frame_addr / FRAME_SIZE;
+    return f < total_frames ? refcount[f] : 0;
+}
+
+uint32_t pmm_total_frame_count(void){ return total_frames; }
+
+uint32_t pmm_used_frame_count(void){
+    uint32_t used = 0;
+    for (int z = 0; z < PMM_ZONE_COUNT; ++z) used += zones[z].present_frames - zones[z].free_frames;
+    return used;
+}
+
+uint32_t pmm_free_frame_count(void){
+    uint32_t free_frames = 0;
+    for (int z = 0; z < PMM_ZONE_COUNT; ++z) free_frames += zones[z].free_frames;
+    return free_frames;
+}
+
+const pmm_zone_t* pmm_get_zone(int zone){
+    if (zone < 0 || zone >= PMM_ZONE_COUNT) return NULL;
+    return &zones[zone];
+}
+
+// ---- Legacy kernel/pmm.h interface (pointer based) ----
+
+void* pmm_alloc(void){ return (void*)pmm_alloc_frame(); }
+void pmm_free(void* addr){ pmm_free_frame((uint32_t)addr); }
+uint32_t pmm_get_free_memory(void){ return pmm_free_frame_count() * FRAME_SIZE; }
+uint32_t pmm_get_used_memory(void){ return pmm_used_frame_count() * FRAME_SIZE; }
+uint32_t pmm_get_total_memory(void){
+    uint32_t present = 0;
+    for (int z = 0; z < PMM_ZONE_COUNT; ++z) present += zones[z].present_frames;
+    return present * FRAME_SIZE;
+}
+
+// ---- Contiguous allocation ----
+// Blocks are carved straight out of the frame bitmap (no separate buddy
+// lists to keep in sync with pmm_alloc_frame). Requests are placed at
+// power-of-two, naturally aligned positions like a binary buddy allocator,
+// and freed frames merge back implicitly through the bitmap.
+
+// Return the index of the first used frame in [start, start+count), or
+// 0xFFFFFFFF if the whole range is free. Scans a word at a time.
+static uint32_t first_used_in_range(uint32_t start, uint32_t count){
+    uint32_t f = start, end = start + count;
+    while (f < end){
+        uint32_t w = f >> 5, bit = f & 31;
+        uint32_t n = 32 - bit;
+        if (n > end - f) n = end - f;
+        uint32_t mask = (n == 32) ? 0xFFFFFFFFu : (((1u << n) - 1) << bit);
+        uint32_t hit = bitmap[w] & mask;
+        if (hit) return (w << 5) + (uint32_t)__builtin_ctz(hit);
+        f += n;
+    }
+    return 0xFFFFFFFFu;
+}
+
+static inline uint32_t order_of(uint32_t count){
+    uint32_t order = 0;
+    while ((1u << order) < count) order++;
+    return order;
+}
+
+// Allocate 'count' physically contiguous frames whose base is aligned to
+// 'alignment' bytes (0 or <= 4KB means page alignment). The base is also
+// aligned to the next power of two >= count, up to PMM_MAX_ORDER.
+uint32_t pmm_alloc_frames(uint32_t count, uint32_t alignment){
+    if (count == 0) return 0;
+    if (count == 1 && alignment <= FRAME_SIZE) return pmm_alloc_frame();
+
+    uint32_t order = order_of(count);
+    if (order > PMM_MAX_ORDER) order = PMM_MAX_ORDER;
+    uint32_t align_frames = 1u << order;
+    if (alignment > FRAME_SIZE){
+        if (alignment & (alignment - 1)) return 0; // not a power of two
+        if (alignment / FRAME_SIZE > align_frames) align_frames = alignment / FRAME_SIZE;
+    }
+
+    uint32_t flags = ticket_lock_irqsave(&pmm_lock);
+    uint32_t start = 0;
+    while (start + count <= total_frames){
+        // Skip whole used words in one step via the summary level
+        uint32_t w = start >> 5;
+        if ((start & 31) == 0 && (summary[w >> 5] & (1u << (w & 31)))){
+            start = (start + 32 + align_frames - 1) & ~(align_frames - 1);
+            continue;
+        }
+        uint32_t used = first_used_in_range(start, count);
+        if (used == 0xFFFFFFFFu){
+            for (uint32_t f = start; f < start + count; ++f){ set_frame(f); refcount[f] = 1; }
+            ticket_unlock_irqrestore(&pmm_lock, flags);
+            return start * FRAME_SIZE;
+        }
+        start = (used + align_frames) & ~(align_frames - 1);
+    }
+    ticket_unlock_irqrestore(&pmm_lock, flags);
+    return 0;
+}
+
+void pmm_free_frames(uint32_t base, uint32_t count){
+    uint32_t f = base / FRAME_SIZE;
+    uint32_t flags = ticket_lock_irqsave(&pmm_lock);
+    for (uint32_t i = 0; i < count && f + i < total_frames; ++i){
+        put_frame(f + i);
+    }
+    ticket_unlock_irqrestore(&pmm_lock, flags);
+}
+
+// Fragmentation view: free runs, largest run, and how many naturally aligned
+// 2^k-frame blocks could still be handed out for each order k
+void pmm_get_frag_stats(pmm_frag_stats_t* out){
+    if (!out) return;
+    for (uint32_t k = 0; k <= PMM_MAX_ORDER; ++k) out->free_blocks[k] = 0;
+    out->free_frames = 0;
+    out->free_runs = 0;
+    out->largest_run = 0;
+
+    uint32_t flags = ticket_lock_irqsave(&pmm_lock);
+    uint32_t f = 0;
+    while (f < total_frames){
+        uint32_t w = f >> 5;
+        if ((f & 31) == 0 && bitmap[w] == 0xFFFFFFFFu){ f += 32; continue; }
+        if (test_frame(f)){ f++; continue; }
+        uint32_t run_start = f;
+        while (f < total_frames && !test_frame(f)) f++;
+        uint32_t run = f - run_start;
+        out->free_frames += run;
+        out->free_runs++;
+        if (run > out->largest_run) out->largest_run = run;
+        for (uint32_t k = 0; k <= PMM_MAX_ORDER; ++k){
+            uint32_t first = (run_start + (1u << k) - 1) >> k;
+            uint32_t last = f >> k;
+            if (last > first) out->free_blocks[k] += last - first;
+        }
+    }
+    ticket_unlock_irqrestore(&pmm_lock, flags);
+}